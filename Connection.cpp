@@ -0,0 +1,260 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Connection.h"
+#include "paths.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QtDebug>
+
+#include <string.h>
+
+Connection::Connection(const Connection &other)
+{
+    type         = other.type;
+    SSID         = other.SSID;
+    profile      = other.profile;
+    quality      = other.quality;
+    signal       = other.signal;
+    load         = other.load;
+    frequency    = other.frequency;
+    age          = other.age;
+    MAC          = other.MAC;
+    active       = other.active;
+    description  = other.description;
+    interface    = other.interface;
+    adHoc        = other.adHoc;
+    ipResolution = other.ipResolution;
+    key          = other.key;
+    pinnedBSSID  = other.pinnedBSSID;
+    autoConnect  = other.autoConnect;
+    associated   = other.associated;
+}
+
+Connection::Connection(QString p, const QString &directory)
+{
+    profile = p;
+    autoConnect = true;
+    type = Unknown;
+    active = false;
+    quality = 0;
+    signal = 0;
+    load = -1;
+    frequency = 0;
+    associated = false;
+    adHoc = false;
+    QFile file((directory.isNull() ? gs_profilePath : directory) + profile);
+    if (!file.exists()) {
+        qDebug() << "attempted to read non existing profile:" << profile;
+        return;
+    }
+    if (!file.open(QIODevice::ReadOnly|QIODevice::Text)) {
+        qDebug() << "attempted to read protected profile:" << profile;
+        return;
+    }
+    Type sec = Unknown;
+    while (!file.atEnd()) {
+        QString line = file.readLine();
+        line = line.section('#', 0, 0).trimmed(); // drop commented stuff
+        if (line.startsWith("Description")) {
+            description = line.section('=', 1);
+        } else if (line.startsWith("Connection")) {
+            QString con(line.section('=', 1));
+            if (con == "ethernet") {
+                quality = 100;
+                type = Ethernet;
+            } else if (con == "wireless") {
+                type = Wireless;
+            }
+            // else if ... TODO: more useless connection types
+        } else if (line.startsWith("Interface")) {
+            interface = line.section('=', 1);
+        } else if (line.startsWith("ESSID")) {
+            SSID = line.section('=', 1);
+        } else if (line.startsWith("Security")) {
+            QString secs(line.section('=', 1));
+            if (secs == "wep")
+                sec = WEP;
+            else if (secs == "wpa")
+                sec = WPA;
+        } else if (line.startsWith("AP=")) {
+            pinnedBSSID = line.section('=', 1).trimmed().toLower();
+        } else if (line.startsWith("Key")) {
+            key = line.section('=', 1);
+        } else if (line.startsWith("IP")) {
+            QString ip = line.section('=', 1).trimmed();
+            if (ipResolution.isEmpty() || ip == "dhcp") // dhcp trumps Address & Gateway definition
+                ipResolution = ip;
+        } else if (line.startsWith("Address")) {
+            if (ipResolution != "dhcp")
+                ipResolution.prepend(line.section('=', 1).trimmed());
+        } else if (line.startsWith("Gateway")) {
+            if (ipResolution != "dhcp")
+                ipResolution.append(';' + line.section('=', 1).trimmed());
+        } else if (line.startsWith("ExcludeAuto")) {
+            autoConnect = line.section('=', 1).trimmed() != "yes";
+        } else if (line.startsWith("Priority")) {
+            // int = line.section('=', 1).trimmed().toInt();
+            void(0);
+        }
+    }
+    file.close();
+    if (type == Wireless && sec)
+        type = sec;
+}
+
+int Connection::qualityFromSignal(double dBm)
+{
+    return qMax(0, qMin(100, int(5*(dBm+90)))); // [-90,-70] -> [0,100]
+}
+
+Connection Connection::fromBss(const WifiBss &b)
+{
+    Connection connection;
+    connection.type = Wireless;
+    const QByteArray mac = b.bssid.toHex();
+    for (int i = 0; i < mac.size(); i += 2) {
+        if (i)
+            connection.MAC += ':';
+        connection.MAC += QLatin1String(mac.mid(i, 2));
+    }
+    if (b.capability & 0x0010) // Privacy
+        connection.type = qMax(connection.type, WEP);
+    if (b.capability & 0x0002) // IBSS
+        connection.adHoc = true;
+    if (b.rsn)
+        connection.type = qMax(connection.type, WPA2);
+    else if (b.wpa)
+        connection.type = qMax(connection.type, WPA1);
+    connection.signal = qRound(b.signal / 100.0);
+    connection.quality = qualityFromSignal(connection.signal);
+    connection.SSID = QString::fromUtf8(b.ssid);
+    connection.frequency = b.frequency;
+    connection.age = b.age;
+    connection.load = b.load;
+    connection.associated = b.associated;
+    return connection;
+}
+
+// byte level helpers for parseIwScan() - the iw output is plain ASCII, except for the SSID
+#define STARTS_WITH(_S_) (e - b >= int(sizeof(_S_)) - 1 && !memcmp(b, _S_, sizeof(_S_) - 1))
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static bool containsWord(const char *b, const char *e, const char *word)
+{
+    const int n = strlen(word);
+    while (b < e) {
+        while (b < e && isBlank(*b))
+            ++b;
+        const char *wordEnd = b;
+        while (wordEnd < e && !isBlank(*wordEnd))
+            ++wordEnd;
+        if (wordEnd - b == n && !memcmp(b, word, n))
+            return true;
+        b = wordEnd;
+    }
+    return false;
+}
+
+static double readDouble(const char *b, const char *e)
+{
+    // strtod and QString::toDouble would depend on the locale, "-45.00 dBm"
+    while (b < e && isBlank(*b))
+        ++b;
+    const bool negative = b < e && *b == '-';
+    if (negative)
+        ++b;
+    double d = 0.0, f = 1.0;
+    for (; b < e && *b >= '0' && *b <= '9'; ++b)
+        d = 10*d + (*b - '0');
+    if (b < e && *b == '.') {
+        for (++b; b < e && *b >= '0' && *b <= '9'; ++b)
+            d += (f /= 10) * (*b - '0');
+    }
+    return negative ? -d : d;
+}
+
+QList<Connection> Connection::parseIwScan(const QByteArray &networks)
+{
+    // single pass over the raw output, only MAC and SSID get materialized as strings
+    QList<Connection> wlans;
+    Connection *connection = 0;
+    const char *line = networks.constData(), *end = line + networks.size();
+    while (line < end) {
+        const char *b = line, *e = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (!e)
+            e = end;
+        line = e + 1;
+        if (STARTS_WITH("BSS ")) { // "BSS 00:11:22:33:44:55(on wlan0) -- associated", the only unindented line
+            wlans << Connection();
+            connection = &wlans.last();
+            connection->type = Wireless;
+            b += 4;
+            const char *m = b;
+            while (m < e && *m != '(' && !isBlank(*m))
+                ++m;
+            connection->MAC = QString::fromLatin1(b, m - b);
+            connection->associated = containsWord(m, e, "associated");
+            continue;
+        }
+        if (!connection)
+            continue;
+        while (b < e && isBlank(*b))
+            ++b;
+        if (STARTS_WITH("capability")) {
+            if (containsWord(b, e, "Privacy"))
+                connection->type = qMax(connection->type, WEP);
+            if (containsWord(b, e, "IBSS"))
+                connection->adHoc = true;
+        } else if (STARTS_WITH("signal:")) {
+            connection->signal = qRound(readDouble(b + 7, e));
+            connection->quality = qualityFromSignal(connection->signal);
+        } else if (STARTS_WITH("freq:")) {
+            connection->frequency = quint32(readDouble(b + 5, e));
+        } else if (STARTS_WITH("last seen:")) { // "120 ms ago"
+            connection->age = quint32(readDouble(b + 10, e));
+        } else if (STARTS_WITH("SSID:")) {
+            b += 5;
+            while (b < e && isBlank(*b))
+                ++b;
+            while (e > b && isBlank(e[-1]))
+                --e;
+            connection->SSID = QString::fromUtf8(b, e - b);
+        } else if (STARTS_WITH("RSN:")) {
+            connection->type = qMax(connection->type, WPA2);
+        } else if (STARTS_WITH("WPA:")) {
+            connection->type = qMax(connection->type, WPA1);
+        } else if (STARTS_WITH("* channel utilisation:")) { // of the BSS Load element, "43/255"
+            connection->load = qint16(readDouble(b + 22, e));
+        }
+    }
+    return wlans;
+}
+
+const char *Connection::typeName(Type type)
+{
+    static const char *names[] = { "unknown", "ethernet", "wireless", "wep", "wpa", "wpa1", "wpa2" };
+    return names[type];
+}
@@ -0,0 +1,80 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_CONNECTION_H
+#define QNETCTL_CONNECTION_H
+
+#include <QDataStream>
+#include <QList>
+#include <QString>
+
+#include "WifiBss.h"
+
+/**
+ * A network as the GUI and the --json mode list it: a profile, a scanned access point,
+ * a bare device or any merge of them
+ */
+class Connection
+{
+public:
+    enum Type { Unknown = 0, Ethernet, Wireless, WEP, WPA, WPA1, WPA2 };
+    Connection() : type(Unknown), quality(0), signal(0), load(-1), frequency(0), age(0),
+                   active(false), adHoc(false), autoConnect(false), associated(false) {}
+    Connection(const Connection &other);
+    /// parses the profile in directory, gs_profilePath by default
+    explicit Connection(QString profile, const QString &directory = QString());
+    /// an access point from the kernels BSS table
+    static Connection fromBss(const WifiBss &bss);
+    /// the access points from "iw dev <device> scan" output
+    static QList<Connection> parseIwScan(const QByteArray &networks);
+    static const char *typeName(Type type);
+    /// maps [-90,-70] dBm to [0,100]
+    static int qualityFromSignal(double dBm);
+    Type type;
+    QString SSID, MAC, description, interface, profile, ipResolution, key;
+    QString pinnedBSSID; // AP= of the profile, netctl won't use any other BSS then
+    int quality;
+    qint16 signal;      // dBm, the average of the recent scans - 0: unknown (wired, profile only)
+    qint16 load;        // channel utilization 0..255, -1: unknown
+    quint32 frequency; // MHz, where the AP was last seen
+    quint32 age;        // ms from the last frame of the AP to reading the scan - not streamed, it's stale by then
+    bool active, adHoc, autoConnect;
+    bool associated;    // the BSS the interface is associated with
+};
+
+// the key is never written, it stays in the (root owned) profile - and the profile fields are read from there
+inline QDataStream &operator<<(QDataStream &s, const Connection &c)
+{
+    return s << qint32(c.type) << c.SSID << c.MAC << c.description << c.interface << c.profile << c.ipResolution
+             << qint32(c.quality) << c.signal << c.load << c.frequency << c.active << c.adHoc << c.autoConnect
+             << c.associated;
+}
+
+inline QDataStream &operator>>(QDataStream &s, Connection &c)
+{
+    qint32 type, quality;
+    s >> type >> c.SSID >> c.MAC >> c.description >> c.interface >> c.profile >> c.ipResolution
+      >> quality >> c.signal >> c.load >> c.frequency >> c.active >> c.adHoc >> c.autoConnect >> c.associated;
+    c.type = Connection::Type(type);
+    c.quality = quality;
+    return s;
+}
+
+#endif // QNETCTL_CONNECTION_H
@@ -0,0 +1,246 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "JsonCli.h"
+#include "LinkMonitor.h"
+#include "Networks.h"
+#include "Nl80211.h"
+#include "ProfileIndex.h"
+#include "SystemdUnits.h"
+#include "paths.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTimer>
+
+#include <stdio.h>
+#include <string.h>
+
+static void print(const QJsonObject &record)
+{
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    line += '\n';
+    fwrite(line.constData(), 1, line.size(), stdout);
+    fflush(stdout); // consumers read the stream line by line, don't hold anything back
+}
+
+static QJsonObject toJson(const char *type, const Connection &con)
+{
+    QJsonObject record;
+    record.insert("type", QLatin1String(type));
+    record.insert("connection", QLatin1String(Connection::typeName(con.type)));
+    if (!con.profile.isEmpty())
+        record.insert("profile", con.profile);
+    if (!con.description.isEmpty())
+        record.insert("description", con.description);
+    if (!con.interface.isEmpty())
+        record.insert("interface", con.interface);
+    if (!con.SSID.isEmpty())
+        record.insert("ssid", con.SSID);
+    if (!con.MAC.isEmpty())
+        record.insert("bssid", con.MAC);
+    if (con.frequency)
+        record.insert("frequency", int(con.frequency));
+    record.insert("quality", con.quality);
+    if (con.signal)
+        record.insert("signal", con.signal);
+    if (con.load > -1)
+        record.insert("load", con.load);
+    if (con.associated)
+        record.insert("associated", true);
+    record.insert("active", con.active);
+    record.insert("adHoc", con.adHoc);
+    record.insert("autoConnect", con.autoConnect);
+    return record; // never the key
+}
+
+static QJsonObject error(const QString &message)
+{
+    QJsonObject record;
+    record.insert("type", QLatin1String("error"));
+    record.insert("message", message);
+    return record;
+}
+
+int JsonCli::exec(const QStringList &arguments)
+{
+    const QString command = arguments.value(0);
+    if (!(command == "list" || command == "scan" || (command == "connect" && arguments.count() == 2))) {
+        fprintf(stderr, "usage: qnetctl --json list | scan [interface ...] | connect <profile>\n");
+        return 2;
+    }
+    JsonCli cli(arguments);
+    QTimer::singleShot(0, &cli, SLOT(start()));
+    return QCoreApplication::exec();
+}
+
+JsonCli::JsonCli(const QStringList &arguments) : QObject()
+, myArguments(arguments)
+, myLinkMonitor(0)
+, myNl80211(0)
+, mySystemdUnits(0)
+, iAmDone(false)
+{
+    myTimeout = new QTimer(this);
+    myTimeout->setSingleShot(true);
+    connect (myTimeout, SIGNAL(timeout()), SLOT(timeout()));
+}
+
+void JsonCli::finish(int code)
+{
+    iAmDone = true;
+    myTimeout->stop();
+    QCoreApplication::exit(code);
+}
+
+void JsonCli::start()
+{
+    const QString command = myArguments.first();
+    if (command == "connect") {
+        // netctl itself checks the privileges, the error message is passed on
+        const QString profile = myArguments.at(1);
+        QProcess netctl;
+        netctl.start(TOOL(netctl), QStringList() << "switch-to" << profile);
+        const bool ok = netctl.waitForFinished(-1) && netctl.exitStatus() == QProcess::NormalExit && !netctl.exitCode();
+        QJsonObject record;
+        record.insert("type", QLatin1String("connect"));
+        record.insert("profile", profile);
+        record.insert("ok", ok);
+        if (!ok)
+            record.insert("message", QString::fromLocal8Bit(netctl.readAllStandardError()).trimmed());
+        print(record);
+        finish(ok ? 0 : 1);
+        return;
+    }
+
+    myLinkMonitor = new LinkMonitor(this);
+    myLinks = myLinkMonitor->links();
+    myNl80211 = new Nl80211(this);
+
+    if (command == "list") {
+        ProfileIndex index;
+        index.update();
+        mySystemdUnits = new SystemdUnits("netctl*", this);
+        foreach (const QString &unit, mySystemdUnits->activeUnits()) {
+            if (unit.startsWith("netctl@"))
+                index.setActive(Networks::profileFromUnit(unit), true);
+        }
+        myProfiles = index.profiles();
+        connect (mySystemdUnits, SIGNAL(enabledUnits(QStringList)), SLOT(printList(QStringList)));
+        mySystemdUnits->refresh();
+        myTimeout->start(2000); // w/o systemd, there's nothing enabled
+        return;
+    }
+
+    // scan
+    QStringList devices = myArguments.mid(1);
+    if (devices.isEmpty()) {
+        for (QMap<QString, bool>::const_iterator it = myLinks.constBegin(),
+                                                end = myLinks.constEnd(); it != end; ++it) {
+            if (*it)
+                devices << it.key();
+        }
+    }
+    connect (myNl80211, SIGNAL(scanFinished(QString)), SLOT(scanFinished(QString)));
+    connect (myNl80211, SIGNAL(scanFailed(QString)), SLOT(scanFailed(QString)));
+    foreach (const QString &device, devices) {
+        if (!myLinks.value(device)) {
+            print(error(device + " is no wireless device"));
+            continue;
+        }
+        if (const int result = myNl80211->triggerScan(device))
+            printScan(device, false, QString::fromLocal8Bit(strerror(-result))); // EPERM w/o root, ENETDOWN
+        else
+            myPendingScans << device;
+    }
+    if (myPendingScans.isEmpty())
+        finish(0);
+    else
+        myTimeout->start(15000);
+}
+
+void JsonCli::printList(QStringList enabledUnits)
+{
+    if (iAmDone)
+        return;
+    QList<Connection> scanned;
+    for (QMap<QString, bool>::const_iterator it = myLinks.constBegin(),
+                                            end = myLinks.constEnd(); it != end; ++it) {
+        if (!*it)
+            continue;
+        foreach (const WifiBss &bss, myNl80211->scanResults(it.key()))
+            scanned << Connection::fromBss(bss);
+    }
+    const QList<Connection> networks = Networks::merge(myProfiles, Networks::strongest(scanned), myLinks,
+                                                       Networks::enabledProfiles(enabledUnits));
+    foreach (const Connection &con, networks)
+        print(toJson("network", con));
+    finish(0);
+}
+
+void JsonCli::printScan(const QString &device, bool fresh, const QString &reason)
+{
+    const WifiBssList bssList = myNl80211->scanResults(device);
+    foreach (const WifiBss &bss, bssList) {
+        Connection con = Connection::fromBss(bss);
+        con.interface = device;
+        print(toJson("bss", con));
+    }
+    QJsonObject record;
+    record.insert("type", QLatin1String("scan"));
+    record.insert("interface", device);
+    record.insert("fresh", fresh); // false: the kernels cache from the last scan of anyone
+    record.insert("count", bssList.count());
+    if (!reason.isEmpty())
+        record.insert("error", reason);
+    print(record);
+}
+
+void JsonCli::scanFinished(QString device)
+{
+    if (!myPendingScans.remove(device))
+        return;
+    printScan(device, true);
+    if (myPendingScans.isEmpty())
+        finish(0);
+}
+
+void JsonCli::scanFailed(QString device)
+{
+    if (!myPendingScans.remove(device))
+        return;
+    printScan(device, false, "scan aborted");
+    if (myPendingScans.isEmpty())
+        finish(0);
+}
+
+void JsonCli::timeout()
+{
+    if (myArguments.first() == "list") {
+        printList();
+        return;
+    }
+    foreach (const QString &device, myPendingScans)
+        printScan(device, false, "timed out");
+    myPendingScans.clear();
+    finish(1);
+}
@@ -0,0 +1,69 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_JSONCLI_H
+#define QNETCTL_JSONCLI_H
+
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+#include "Connection.h"
+
+class LinkMonitor;
+class Nl80211;
+class SystemdUnits;
+class QTimer;
+
+/**
+ * "qnetctl --json list|scan|connect" - no QApplication, widgets or helper
+ * Every record is printed as one compact JSON object per line as soon as it's known.
+ * Scanning and connecting need root, unprivileged scans report the kernels scan cache.
+ */
+class JsonCli : public QObject
+{
+    Q_OBJECT
+public:
+    /// runs the command in arguments, QCoreApplication must exist. Returns the exit code
+    static int exec(const QStringList &arguments);
+private:
+    JsonCli(const QStringList &arguments);
+    void finish(int code);
+    void printScan(const QString &device, bool fresh, const QString &reason = QString());
+private slots:
+    void start();
+    void printList(QStringList enabledUnits = QStringList());
+    void scanFinished(QString device);
+    void scanFailed(QString device);
+    void timeout();
+private:
+    QStringList myArguments;
+    LinkMonitor *myLinkMonitor;
+    Nl80211 *myNl80211;
+    SystemdUnits *mySystemdUnits;
+    QList<Connection> myProfiles;
+    QMap<QString, bool> myLinks;
+    QSet<QString> myPendingScans;
+    QTimer *myTimeout;
+    bool iAmDone;
+};
+
+#endif // QNETCTL_JSONCLI_H
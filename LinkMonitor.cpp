@@ -0,0 +1,251 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "LinkMonitor.h"
+#include "Netlink.h"
+
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+
+// RTM_NEWLINK is handled synchronously in sendto(), dev_open() loading the firmware included - that
+// can take seconds, so the requests are sent from here and only their outcome is queued back
+class LinkSwitcher : public QThread
+{
+public:
+    LinkSwitcher(QObject *monitor) : myMonitor(monitor), iShallStop(false) {}
+    void post(const QString &interface, unsigned int index, bool up)
+    {
+        QMutexLocker lock(&myMutex);
+        Request request = { interface, index, up };
+        myRequests << request;
+        myWakeUp.wakeOne();
+    }
+    void stop()
+    {
+        myMutex.lock();
+        iShallStop = true;
+        myWakeUp.wakeOne();
+        myMutex.unlock();
+        wait();
+    }
+protected:
+    void run()
+    {
+        NetlinkSocket socket(NETLINK_ROUTE);
+        QMutexLocker lock(&myMutex);
+        while (!iShallStop) {
+            if (myRequests.isEmpty()) {
+                myWakeUp.wait(&myMutex);
+                continue;
+            }
+            const Request request = myRequests.takeFirst();
+            lock.unlock();
+            NetlinkMessage msg(RTM_NEWLINK, NLM_F_ACK, sizeof(ifinfomsg));
+            ifinfomsg *ifi = static_cast<ifinfomsg*>(msg.header());
+            ifi->ifi_family = AF_UNSPEC;
+            ifi->ifi_index = request.index;
+            ifi->ifi_change = IFF_UP;
+            ifi->ifi_flags = request.up ? IFF_UP : 0;
+            const int error = socket.transact(msg, 0, 0);
+            QMetaObject::invokeMethod(myMonitor, "linkSet", Qt::QueuedConnection, Q_ARG(QString, request.interface),
+                                      Q_ARG(bool, request.up), Q_ARG(int, error));
+            lock.relock();
+        }
+    }
+private:
+    struct Request { QString interface; unsigned int index; bool up; };
+    QObject *myMonitor;
+    QMutex myMutex;
+    QWaitCondition myWakeUp;
+    QList<Request> myRequests;
+    bool iShallStop;
+};
+
+LinkMonitor::LinkMonitor(QObject *parent) : QObject(parent), mySwitcher(0), myNotifier(0)
+{
+    mySocket = new NetlinkSocket(NETLINK_ROUTE, RTMGRP_LINK);
+    myRequestSocket = new NetlinkSocket(NETLINK_ROUTE); // no events, so they can't get in the way
+    if (!mySocket->isValid())
+        return;
+    myNotifier = new QSocketNotifier(mySocket->fd(), QSocketNotifier::Read, this);
+    connect (myNotifier, SIGNAL(activated(int)), SLOT(readEvents()));
+}
+
+LinkMonitor::~LinkMonitor()
+{
+    if (mySwitcher)
+        mySwitcher->stop();
+    delete mySwitcher;
+    delete myNotifier;
+    delete mySocket;
+    delete myRequestSocket;
+}
+
+bool LinkMonitor::isValid() const
+{
+    return mySocket->isValid();
+}
+
+bool LinkMonitor::watchAddresses()
+{
+    return mySocket->addMembership(RTNLGRP_IPV4_IFADDR) && mySocket->addMembership(RTNLGRP_IPV6_IFADDR);
+}
+
+void LinkMonitor::refresh()
+{
+    NetlinkMessage msg(RTM_GETLINK, NLM_F_DUMP, sizeof(ifinfomsg));
+    static_cast<ifinfomsg*>(msg.header())->ifi_family = AF_UNSPEC;
+    mySocket->send(msg); // the replies arrive through the notifier like any other event
+}
+
+static void readFlags(const nlmsghdr *nh, void *context)
+{
+    if (nh->nlmsg_type == RTM_NEWLINK)
+        *static_cast<int*>(context) = static_cast<const ifinfomsg*>(NLMSG_DATA(nh))->ifi_flags;
+}
+
+int LinkMonitor::flags(const QString &interface)
+{
+    const unsigned int index = if_nametoindex(interface.toLocal8Bit().constData());
+    if (!index)
+        return -ENODEV;
+    NetlinkMessage msg(RTM_GETLINK, 0, sizeof(ifinfomsg));
+    ifinfomsg *ifi = static_cast<ifinfomsg*>(msg.header());
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_index = index;
+    int flags = -ENODEV;
+    if (int error = myRequestSocket->transact(msg, readFlags, &flags))
+        return error;
+    return flags;
+}
+
+bool LinkMonitor::setUp(const QString &interface, bool up)
+{
+    const unsigned int index = if_nametoindex(interface.toLocal8Bit().constData());
+    if (!index)
+        return false;
+    if (!mySwitcher) { // only the helper sets links up, the GUI doesn't need the thread
+        mySwitcher = new LinkSwitcher(this);
+        mySwitcher->start();
+    }
+    mySwitcher->post(interface, index, up);
+    return true;
+}
+
+void LinkMonitor::linkSet(QString interface, bool up, int error)
+{
+    if (error)
+        emit setUpFailed(interface, up, error);
+}
+
+struct LinkEvent { QString interface; uint flags; bool removed; };
+
+static void readLink(const nlmsghdr *nh, void *context)
+{
+    if (nh->nlmsg_type != RTM_NEWLINK && nh->nlmsg_type != RTM_DELLINK)
+        return;
+    const ifinfomsg *ifi = static_cast<const ifinfomsg*>(NLMSG_DATA(nh));
+    if (!(ifi->ifi_flags & IFF_BROADCAST))
+        return;
+    const nlattr *tb[IFLA_MAX + 1];
+    nlParse(tb, IFLA_MAX, reinterpret_cast<const char*>(ifi) + NLMSG_ALIGN(sizeof(ifinfomsg)),
+                          nh->nlmsg_len - NLMSG_LENGTH(sizeof(ifinfomsg)));
+    if (!tb[IFLA_IFNAME])
+        return;
+    if (tb[IFLA_WIRELESS] && nh->nlmsg_type == RTM_NEWLINK)
+        return; // wireless extension event (scan, association) - not a state change
+    LinkEvent event;
+    event.interface = QString::fromLocal8Bit(static_cast<const char*>(nlData(tb[IFLA_IFNAME])));
+    event.flags = ifi->ifi_flags;
+    event.removed = nh->nlmsg_type == RTM_DELLINK;
+    static_cast<QList<LinkEvent>*>(context)->append(event);
+}
+
+struct AddressEvent { QString interface, address; };
+struct Events { QList<LinkEvent> links; QList<AddressEvent> addresses; };
+
+static void readAddress(const nlmsghdr *nh, QList<AddressEvent> *addresses)
+{
+    const ifaddrmsg *ifa = static_cast<const ifaddrmsg*>(NLMSG_DATA(nh));
+    if (ifa->ifa_scope != RT_SCOPE_UNIVERSE)
+        return; // fe80::/10 comes with every link up, it says nothing about the network
+    const nlattr *tb[IFA_MAX + 1];
+    nlParse(tb, IFA_MAX, reinterpret_cast<const char*>(ifa) + NLMSG_ALIGN(sizeof(ifaddrmsg)),
+                         nh->nlmsg_len - NLMSG_LENGTH(sizeof(ifaddrmsg)));
+    const nlattr *a = tb[IFA_LOCAL] ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+    char name[IF_NAMESIZE], text[INET6_ADDRSTRLEN];
+    if (!a || !if_indextoname(ifa->ifa_index, name) || !inet_ntop(ifa->ifa_family, nlData(a), text, sizeof(text)))
+        return;
+    AddressEvent event = { QString::fromLocal8Bit(name), QString::fromLatin1(text) + '/' + QString::number(ifa->ifa_prefixlen) };
+    addresses->append(event);
+}
+
+static void readEvent(const nlmsghdr *nh, void *context)
+{
+    Events *events = static_cast<Events*>(context);
+    if (nh->nlmsg_type == RTM_NEWADDR)
+        readAddress(nh, &events->addresses);
+    else
+        readLink(nh, &events->links);
+}
+
+static bool isWireless(const QString &interface)
+{
+    return QFile::exists("/sys/class/net/" + interface + "/wireless") ||
+           QFile::exists("/sys/class/net/" + interface + "/phy80211");
+}
+
+QMap<QString, bool> LinkMonitor::links()
+{
+    QMap<QString, bool> links;
+    NetlinkMessage msg(RTM_GETLINK, NLM_F_DUMP, sizeof(ifinfomsg));
+    static_cast<ifinfomsg*>(msg.header())->ifi_family = AF_UNSPEC;
+    QList<LinkEvent> events;
+    if (myRequestSocket->transact(msg, readLink, &events))
+        return links;
+    foreach (const LinkEvent &event, events)
+        links.insert(event.interface, isWireless(event.interface));
+    return links;
+}
+
+void LinkMonitor::readEvents()
+{
+    Events events;
+    if (!mySocket->dispatch(readEvent, &events))
+        refresh(); // we missed something, get the full picture again
+    foreach (const LinkEvent &event, events.links) {
+        if (event.removed)
+            emit linkRemoved(event.interface);
+        else
+            emit linkChanged(event.interface, event.flags & IFF_UP, event.flags & IFF_RUNNING, isWireless(event.interface));
+    }
+    foreach (const AddressEvent &event, events.addresses)
+        emit addressAdded(event.interface, event.address);
+}
@@ -0,0 +1,70 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_LINKMONITOR_H
+#define QNETCTL_LINKMONITOR_H
+
+#include <QMap>
+#include <QObject>
+
+class LinkSwitcher;
+class NetlinkSocket;
+class QSocketNotifier;
+
+/**
+ * Subscribes to RTMGRP_LINK on a NETLINK_ROUTE socket and reports every broadcast capable
+ * link as it appears, changes or vanishes - no polling, no "ip link show"
+ * On request, global IPv4/IPv6 addresses are reported as they get assigned.
+ */
+class LinkMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    LinkMonitor(QObject *parent = 0);
+    ~LinkMonitor();
+    bool isValid() const;
+    /// subscribes to the address changes for addressAdded() - every DHCP renewal wakes us then
+    bool watchAddresses();
+    /// requests a dump of all links, they'll arrive as linkChanged() signals
+    void refresh();
+    /// synchronous dump of the broadcast capable links, interface -> wireless
+    QMap<QString, bool> links();
+    /// IFF_* flags of the link or -errno, the kernel answers right away
+    int flags(const QString &interface);
+    /// sets the link up or down from a worker thread: the kernel opens the device (and loads its firmware)
+    /// before it answers the request - the new state arrives as linkChanged(), a failure as setUpFailed()
+    bool setUp(const QString &interface, bool up);
+signals:
+    void linkChanged(QString interface, bool up, bool carrier, bool wireless);
+    void linkRemoved(QString interface);
+    /// address/prefix length, not the link local ones
+    void addressAdded(QString interface, QString address);
+    /// the kernel refused to set the link up or down, error is -errno
+    void setUpFailed(QString interface, bool up, int error);
+private slots:
+    void linkSet(QString interface, bool up, int error);
+    void readEvents();
+private:
+    LinkSwitcher *mySwitcher;
+    NetlinkSocket *mySocket, *myRequestSocket;
+    QSocketNotifier *myNotifier;
+};
+
+#endif // QNETCTL_LINKMONITOR_H
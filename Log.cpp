@@ -0,0 +1,248 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Log.h"
+
+#include <QFile>
+#include <QThread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// bounded multi producer, single consumer ring (Vyukov) - a slot's sequence is its position while
+// it's free, position + 1 once it's written and position + Capacity once it's flushed
+struct Slot
+{
+    QAtomicInteger<quint32> sequence;
+    qint64 time; // CLOCK_REALTIME, ns
+    int level;
+    char text[Log::TextSize];
+};
+
+static Slot gs_slots[Log::Capacity];
+static QAtomicInteger<quint32> gs_head;         // next position to claim
+static quint32 gs_tail = 0;                     // next position to flush, only the flusher moves it
+static QAtomicInt gs_dropped;                   // while the ring was full
+static QAtomicInt gs_threshold(Log::Error + 1); // nothing is logged before open()
+static int gs_fd = -1;
+static QAtomicInt gs_crashDumped;               // qFatal() dumps before abort(), SIGABRT must not again
+static const char gs_levels[] = "DIWE";
+
+static void writeAll(const char *data, int length)
+{
+    while (length > 0) {
+        const ssize_t n = ::write(gs_fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += n;
+        length -= n;
+    }
+}
+
+static void flush()
+{
+    char buffer[16384];
+    int used = 0;
+    forever {
+        Slot &slot = gs_slots[gs_tail % Log::Capacity];
+        if (slot.sequence.loadAcquire() != gs_tail + 1)
+            break; // empty, or its producer is still at it
+        if (used + Log::TextSize + 64 > int(sizeof(buffer))) {
+            writeAll(buffer, used);
+            used = 0;
+        }
+        const time_t seconds = slot.time / 1000000000;
+        struct tm tm;
+        localtime_r(&seconds, &tm);
+        used += strftime(buffer + used, sizeof(buffer) - used, "%Y-%m-%d %H:%M:%S", &tm);
+        used += snprintf(buffer + used, sizeof(buffer) - used, ".%03d %c %s\n",
+                         int(slot.time / 1000000 % 1000), gs_levels[slot.level], slot.text);
+        slot.sequence.storeRelease(gs_tail + Log::Capacity);
+        ++gs_tail;
+    }
+    if (const int dropped = gs_dropped.fetchAndStoreRelaxed(0))
+        used += snprintf(buffer + used, sizeof(buffer) - used, "-- %d messages dropped, the ring was full\n", dropped);
+    writeAll(buffer, used);
+}
+
+class Flusher : public QThread
+{
+public:
+    void stop() { iShallStop.storeRelease(1); wait(); }
+protected:
+    void run() {
+        while (!iShallStop.loadAcquire()) {
+            flush();
+            msleep(100); // the producers don't wake us, they never touch a lock
+        }
+        flush();
+    }
+private:
+    QAtomicInt iShallStop;
+};
+
+static Flusher *gs_flusher = 0;
+
+bool Log::open(const QString &path, Level threshold)
+{
+    if (gs_flusher)
+        return false;
+    // O_NOFOLLOW: the helper runs as root
+    gs_fd = ::open(QFile::encodeName(path).constData(), O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC|O_NOFOLLOW, 0640);
+    if (gs_fd < 0)
+        return false;
+    for (quint32 i = 0; i < Capacity; ++i)
+        gs_slots[i].sequence.store(i);
+    gs_flusher = new Flusher;
+    gs_flusher->start(QThread::LowestPriority);
+    gs_threshold.storeRelease(threshold);
+    return true;
+}
+
+Log::Level Log::levelFromEnv(const char *variable, Level fallback)
+{
+    const QByteArray level = qgetenv(variable).toLower();
+    if (level == "debug")
+        return Debug;
+    if (level == "info")
+        return Info;
+    if (level == "warning")
+        return Warning;
+    if (level == "error")
+        return Error;
+    return fallback;
+}
+
+void Log::close()
+{
+    if (!gs_flusher)
+        return;
+    gs_threshold.storeRelease(Error + 1);
+    gs_flusher->stop();
+    delete gs_flusher;
+    gs_flusher = 0;
+    ::close(gs_fd);
+    gs_fd = -1;
+}
+
+bool Log::isEnabled(Level level)
+{
+    return level >= gs_threshold.load();
+}
+
+void Log::write(Level level, Site &site, const char *format, ...)
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    int suppressed = 0;
+    const qint64 second = site.second.load();
+    if (second != ts.tv_sec && site.second.testAndSetRelaxed(second, ts.tv_sec)) {
+        site.count.store(0);
+        suppressed = site.suppressed.fetchAndStoreRelaxed(0);
+    }
+    if (site.count.fetchAndAddRelaxed(1) >= SiteRate) {
+        site.suppressed.fetchAndAddRelaxed(1);
+        return;
+    }
+
+    quint32 position = gs_head.load();
+    Slot *slot;
+    forever {
+        slot = &gs_slots[position % Capacity];
+        const qint32 diff = qint32(slot->sequence.loadAcquire() - position);
+        if (!diff) {
+            if (gs_head.testAndSetRelaxed(position, position + 1, position))
+                break; // it's ours
+        } else if (diff < 0) {
+            gs_dropped.fetchAndAddRelaxed(1); // full, the flusher is behind
+            return;
+        } else {
+            position = gs_head.load(); // another producer was faster
+        }
+    }
+    slot->time = qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    slot->level = level;
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(slot->text, TextSize, format, args);
+    va_end(args);
+    if (suppressed && length >= 0 && length < TextSize - 1)
+        snprintf(slot->text + length, TextSize - length, " [%d more suppressed]", suppressed);
+    slot->sequence.storeRelease(position + 1);
+}
+
+static QtMessageHandler gs_previousHandler = 0;
+
+static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    static Log::Site sites[5];
+    Log::Level level = Log::Info;
+    switch (type) {
+    case QtDebugMsg:    level = Log::Debug; break;
+    case QtWarningMsg:  level = Log::Warning; break;
+    case QtCriticalMsg:
+    case QtFatalMsg:    level = Log::Error; break;
+    default:            break;
+    }
+    if (Log::isEnabled(level))
+        Log::write(level, sites[type % 5], "%s", qPrintable(message));
+    else if (gs_previousHandler) // below the threshold, eg. QNETCTL_DEBUG_SCAN, still reaches stderr
+        gs_previousHandler(type, context, message);
+    else
+        fprintf(stderr, "%s\n", qPrintable(message));
+    if (type == QtFatalMsg) {
+        Log::crashDump();
+        abort();
+    }
+}
+
+void Log::captureQtMessages()
+{
+    if (gs_flusher) // otherwise they'd better go to stderr
+        gs_previousHandler = qInstallMessageHandler(messageHandler);
+}
+
+void Log::crashDump()
+{
+    if (gs_fd < 0 || !gs_crashDumped.testAndSetOrdered(0, 1))
+        return;
+    static const char header[] = "-- crashed, the messages that were not flushed yet:\n";
+    writeAll(header, sizeof(header) - 1);
+    const quint32 head = gs_head.load();
+    for (quint32 position = gs_tail; position != head; ++position) {
+        const Slot &slot = gs_slots[position % Capacity];
+        if (slot.sequence.loadAcquire() != position + 1)
+            continue; // half written
+        const char level[2] = { gs_levels[slot.level], ' ' };
+        writeAll(level, 2);
+        writeAll(slot.text, strnlen(slot.text, TextSize));
+        writeAll("\n", 1);
+    }
+}
@@ -0,0 +1,70 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_LOG_H
+#define QNETCTL_LOG_H
+
+#include <QAtomicInteger>
+#include <QString>
+
+/**
+ * Leveled logger for the helper (and the GUI), cheap enough to stay on in production.
+ * LOG() formats into a preallocated slot of a lock-free ring and returns, a background thread
+ * writes the ring to the (kept open) file. When the ring is full, messages are dropped and
+ * counted instead of blocking the caller. Every LOG() call site is limited to SiteRate messages
+ * per second, the number of suppressed ones is appended to the next message that gets through.
+ */
+namespace Log
+{
+    enum Level { Debug = 0, Info, Warning, Error };
+    enum { Capacity = 1024, TextSize = 240, SiteRate = 20 };
+
+    /// rate limit state of one LOG() call site
+    struct Site {
+        QAtomicInteger<qint64> second;
+        QAtomicInt count, suppressed;
+    };
+
+    /// appends to path and starts the flusher, messages below threshold are discarded right away
+    bool open(const QString &path, Level threshold);
+    /// $variable = debug|info|warning|error
+    Level levelFromEnv(const char *variable, Level fallback);
+    /// writes what's left and stops the flusher
+    void close();
+    bool isEnabled(Level level);
+    void write(Level level, Site &site, const char *format, ...)
+#ifdef __GNUC__
+        __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+    /// routes qDebug(), qWarning() etc. into the log, if open() succeeded
+    /// those below the threshold are passed on to the previous handler (stderr)
+    void captureQtMessages();
+    /// async-signal-safe: writes the messages the flusher did not get to yet, for crash handlers - once
+    void crashDump();
+}
+
+#define LOG(_L_, ...) do { \
+    static Log::Site logSite; \
+    if (Log::isEnabled(Log::_L_)) \
+        Log::write(Log::_L_, logSite, __VA_ARGS__); \
+} while (0)
+
+#endif // QNETCTL_LOG_H
@@ -0,0 +1,154 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Metrics.h"
+
+#include <QMap>
+#include <QSaveFile>
+
+Metrics::Histogram::Histogram(const QVector<qint64> &bounds) : myBounds(bounds), myBuckets(bounds.count() + 1)
+{
+}
+
+void Metrics::Histogram::observe(qint64 value)
+{
+    int i = 0;
+    while (i < myBounds.count() && value > myBounds.at(i))
+        ++i;
+    myBuckets[i].fetchAndAddRelaxed(1);
+    mySum.fetchAndAddRelaxed(value);
+    myCount.fetchAndAddRelaxed(1);
+}
+
+namespace {
+struct Family
+{
+    Family() : type(0), help(0), scale(1.0) {}
+    const char *type;
+    const char *help;
+    double scale;
+    // by the formatted labels
+    QMap<QString, Metrics::Counter*> counters;
+    QMap<QString, Metrics::Gauge*> gauges;
+    QMap<QString, Metrics::Histogram*> histograms;
+};
+}
+
+static QMap<QByteArray, Family> gs_families; // the metrics live as long as the process
+
+static Family &family(const char *name, const char *type, const char *help, double scale = 1.0)
+{
+    Family &f = gs_families[name];
+    if (!f.type) {
+        f.type = type;
+        f.help = help;
+        f.scale = scale;
+    }
+    return f;
+}
+
+QString Metrics::label(const char *name, const QString &value)
+{
+    QString escaped = value;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return QString::fromLatin1(name) + "=\"" + escaped + '"';
+}
+
+Metrics::Counter &Metrics::counter(const char *name, const char *help, const QString &labels)
+{
+    Counter *&c = family(name, "counter", help).counters[labels];
+    if (!c)
+        c = new Counter;
+    return *c;
+}
+
+Metrics::Gauge &Metrics::gauge(const char *name, const char *help, const QString &labels)
+{
+    Gauge *&g = family(name, "gauge", help).gauges[labels];
+    if (!g)
+        g = new Gauge;
+    return *g;
+}
+
+Metrics::Histogram &Metrics::histogram(const char *name, const char *help, const QVector<qint64> &bounds,
+                                       double scale, const QString &labels)
+{
+    Histogram *&h = family(name, "histogram", help, scale).histograms[labels];
+    if (!h)
+        h = new Histogram(bounds);
+    return *h;
+}
+
+static QByteArray number(double value)
+{
+    return QByteArray::number(value, 'g', 12);
+}
+
+static QByteArray sample(const QByteArray &name, const QString &labels, const QByteArray &value,
+                         const QByteArray &le = QByteArray())
+{
+    QByteArray line = name;
+    if (!(labels.isEmpty() && le.isEmpty())) {
+        line += '{' + labels.toUtf8();
+        if (!le.isEmpty())
+            line += (labels.isEmpty() ? "le=\"" : ",le=\"") + le + '"';
+        line += '}';
+    }
+    return line + ' ' + value + '\n';
+}
+
+QByteArray Metrics::text()
+{
+    QByteArray text;
+    for (QMap<QByteArray, Family>::const_iterator it = gs_families.constBegin(),
+                                                 end = gs_families.constEnd(); it != end; ++it) {
+        const QByteArray &name = it.key();
+        const Family &f = *it;
+        text += "# TYPE " + name + ' ' + f.type + '\n';
+        text += "# HELP " + name + ' ' + f.help + '\n';
+        for (QMap<QString, Counter*>::const_iterator c = f.counters.constBegin(); c != f.counters.constEnd(); ++c)
+            text += sample(name, c.key(), number((*c)->value() / f.scale));
+        for (QMap<QString, Gauge*>::const_iterator g = f.gauges.constBegin(); g != f.gauges.constEnd(); ++g)
+            text += sample(name, g.key(), number((*g)->value() / f.scale));
+        for (QMap<QString, Histogram*>::const_iterator h = f.histograms.constBegin(); h != f.histograms.constEnd(); ++h) {
+            const Histogram &histogram = **h;
+            qint64 cumulative = 0;
+            for (int i = 0; i < histogram.bounds().count(); ++i) {
+                cumulative += histogram.bucket(i);
+                text += sample(name + "_bucket", h.key(), QByteArray::number(cumulative),
+                               number(histogram.bounds().at(i) / f.scale));
+            }
+            cumulative += histogram.bucket(histogram.bounds().count());
+            text += sample(name + "_bucket", h.key(), QByteArray::number(cumulative), "+Inf");
+            text += sample(name + "_sum", h.key(), number(histogram.sum() / f.scale));
+            text += sample(name + "_count", h.key(), QByteArray::number(histogram.count()));
+        }
+    }
+    return text + "# EOF\n";
+}
+
+bool Metrics::write(const QString &path)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(text());
+    return file.commit();
+}
@@ -0,0 +1,87 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_METRICS_H
+#define QNETCTL_METRICS_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/**
+ * Process wide registry of counters, gauges and fixed bucket histograms, exported as a text
+ * file for the node_exporter textfile collector.
+ * Updating a metric is a relaxed atomic add, looking one up by name and labels is a map
+ * access and must happen on the thread that owns the registry (the GUI thread).
+ */
+namespace Metrics
+{
+    class Counter
+    {
+    public:
+        void inc(qint64 n = 1) { myValue.fetchAndAddRelaxed(n); }
+        qint64 value() const { return myValue.load(); }
+    private:
+        QAtomicInteger<qint64> myValue;
+    };
+
+    class Gauge
+    {
+    public:
+        void set(qint64 value) { myValue.store(value); }
+        qint64 value() const { return myValue.load(); }
+    private:
+        QAtomicInteger<qint64> myValue;
+    };
+
+    class Histogram
+    {
+    public:
+        /// bounds are the inclusive upper limits of the buckets, ascending, "+Inf" is implied
+        Histogram(const QVector<qint64> &bounds);
+        void observe(qint64 value);
+        const QVector<qint64> &bounds() const { return myBounds; }
+        qint64 bucket(int i) const { return myBuckets.at(i).load(); }
+        qint64 sum() const { return mySum.load(); }
+        qint64 count() const { return myCount.load(); }
+    private:
+        QVector<qint64> myBounds;
+        QVector<QAtomicInteger<qint64> > myBuckets; // not cumulative, the last one is +Inf
+        QAtomicInteger<qint64> mySum, myCount;
+    };
+
+    /// name="value", escaped - the labels parameter of the lookups below
+    QString label(const char *name, const QString &value);
+
+    /// the first lookup of a name defines help (and bounds and scale), the exported value is
+    /// the recorded one divided by scale - eg. record ms, export seconds with scale 1000
+    Counter &counter(const char *name, const char *help, const QString &labels = QString());
+    Gauge &gauge(const char *name, const char *help, const QString &labels = QString());
+    Histogram &histogram(const char *name, const char *help, const QVector<qint64> &bounds,
+                         double scale = 1.0, const QString &labels = QString());
+
+    /// the text exposition of all metrics
+    QByteArray text();
+    /// atomically replaces path, the collector must never see a partial file
+    bool write(const QString &path);
+}
+
+#endif // QNETCTL_METRICS_H
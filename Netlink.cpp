@@ -0,0 +1,179 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Netlink.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef SOL_NETLINK
+#define SOL_NETLINK 270
+#endif
+
+NetlinkMessage::NetlinkMessage(quint16 type, quint16 flags, int headerSize)
+{
+    myBuffer.reserve(256);
+    myBuffer.fill(0, NLMSG_HDRLEN + NLMSG_ALIGN(headerSize));
+    nlmsghdr *nh = reinterpret_cast<nlmsghdr*>(myBuffer.data());
+    nh->nlmsg_type = type;
+    nh->nlmsg_flags = NLM_F_REQUEST | flags;
+}
+
+void NetlinkMessage::put(quint16 type, const void *data, int length)
+{
+    const int offset = myBuffer.size();
+    myBuffer.append(QByteArray(NLA_ALIGN(NLA_HDRLEN + length), '\0'));
+    nlattr *a = reinterpret_cast<nlattr*>(myBuffer.data() + offset);
+    a->nla_type = type;
+    a->nla_len = NLA_HDRLEN + length;
+    if (length)
+        memcpy(myBuffer.data() + offset + NLA_HDRLEN, data, length);
+}
+
+int NetlinkMessage::beginNested(quint16 type)
+{
+    const int offset = myBuffer.size();
+    put(type, 0, 0);
+    return offset;
+}
+
+void NetlinkMessage::endNested(int offset)
+{
+    reinterpret_cast<nlattr*>(myBuffer.data() + offset)->nla_len = myBuffer.size() - offset;
+}
+
+const QByteArray &NetlinkMessage::finish(quint32 sequence)
+{
+    nlmsghdr *nh = reinterpret_cast<nlmsghdr*>(myBuffer.data());
+    nh->nlmsg_len = myBuffer.size();
+    nh->nlmsg_seq = sequence;
+    return myBuffer;
+}
+
+void nlParse(const nlattr **tb, int max, const void *data, int length)
+{
+    memset(tb, 0, sizeof(nlattr*) * (max + 1));
+    const char *d = static_cast<const char*>(data);
+    while (length >= NLA_HDRLEN) {
+        const nlattr *a = reinterpret_cast<const nlattr*>(d);
+        if (a->nla_len < NLA_HDRLEN || a->nla_len > length)
+            break;
+        const int type = a->nla_type & NLA_TYPE_MASK;
+        if (type <= max)
+            tb[type] = a;
+        const int step = NLA_ALIGN(a->nla_len);
+        d += step;
+        length -= step;
+    }
+}
+
+NetlinkSocket::NetlinkSocket(int protocol, quint32 groups) : mySequence(0)
+{
+    myFd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, protocol);
+    if (myFd < 0)
+        return;
+    sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = groups;
+    if (bind(myFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(myFd);
+        myFd = -1;
+        return;
+    }
+    int size = 256*1024; // scan result dumps and link floods (USB hubs) are bursty
+    setsockopt(myFd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    myBuffer.resize(64*1024);
+}
+
+NetlinkSocket::~NetlinkSocket()
+{
+    if (myFd > -1)
+        close(myFd);
+}
+
+bool NetlinkSocket::addMembership(quint32 group)
+{
+    return isValid() && !setsockopt(myFd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &group, sizeof(group));
+}
+
+quint32 NetlinkSocket::send(NetlinkMessage &message)
+{
+    if (!isValid())
+        return 0;
+    const QByteArray &data = message.finish(++mySequence);
+    sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    if (sendto(myFd, data.constData(), data.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        return 0;
+    return mySequence;
+}
+
+int NetlinkSocket::transact(NetlinkMessage &message, Handler handler, void *context)
+{
+    const quint32 sequence = send(message);
+    if (!sequence)
+        return -errno;
+    return read(sequence, handler, context, true);
+}
+
+bool NetlinkSocket::dispatch(Handler handler, void *context)
+{
+    return read(0, handler, context, false) != -ENOBUFS;
+}
+
+int NetlinkSocket::read(quint32 sequence, Handler handler, void *context, bool block)
+{
+    forever {
+        ssize_t n = recv(myFd, myBuffer.data(), myBuffer.size(), 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN && block) {
+                pollfd pfd = { myFd, POLLIN, 0 };
+                if (poll(&pfd, 1, 1000) > 0) // the kernel answers immediately, this is a safety net
+                    continue;
+                return -ETIMEDOUT;
+            }
+            return -errno; // EAGAIN: nothing left to dispatch
+        }
+        int len = n;
+        for (const nlmsghdr *nh = reinterpret_cast<const nlmsghdr*>(myBuffer.constData());
+                                 NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (sequence && nh->nlmsg_seq != sequence)
+                continue; // stale reply to some earlier, timed out request
+            if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR) {
+                if (!sequence)
+                    continue; // end of some dump we sent w/o waiting for it
+                if (nh->nlmsg_type == NLMSG_DONE)
+                    return 0;
+                return static_cast<const nlmsgerr*>(NLMSG_DATA(nh))->error; // 0 is the ack
+            }
+            if (handler)
+                handler(nh, context);
+            if (sequence && !(nh->nlmsg_flags & NLM_F_MULTI))
+                return 0; // single reply w/o ack
+        }
+    }
+    return 0;
+}
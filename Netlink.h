@@ -0,0 +1,83 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_NETLINK_H
+#define QNETCTL_NETLINK_H
+
+#include <QByteArray>
+
+#include <linux/netlink.h>
+#include <string.h>
+
+/**
+ * Builds a netlink request: nlmsghdr, a protocol specific header of headerSize bytes
+ * (genlmsghdr, ifinfomsg, ...) and a flat list of attributes
+ */
+class NetlinkMessage
+{
+public:
+    NetlinkMessage(quint16 type, quint16 flags, int headerSize);
+    void *header() { return myBuffer.data() + NLMSG_HDRLEN; }
+    void put(quint16 type, const void *data, int length);
+    void putU32(quint16 type, quint32 value) { put(type, &value, sizeof(value)); }
+    void putString(quint16 type, const char *string) { put(type, string, strlen(string) + 1); }
+    int beginNested(quint16 type);
+    void endNested(int offset);
+    const QByteArray &finish(quint32 sequence);
+private:
+    QByteArray myBuffer;
+};
+
+/**
+ * Non-blocking netlink socket, the owner is supposed to hook fd() into a QSocketNotifier
+ * Replies to own requests (acks, dumps) come straight from the kernel and are read synchronously.
+ */
+class NetlinkSocket
+{
+public:
+    typedef void (*Handler)(const nlmsghdr *message, void *context);
+    NetlinkSocket(int protocol, quint32 groups = 0);
+    ~NetlinkSocket();
+    int fd() const { return myFd; }
+    bool isValid() const { return myFd > -1; }
+    bool addMembership(quint32 group);
+    quint32 send(NetlinkMessage &message);
+    /// sends and processes the replies until ack/done, returns 0 or -errno
+    int transact(NetlinkMessage &message, Handler handler, void *context);
+    /// reads pending datagrams w/o blocking and passes every message to handler
+    /// returns false if the receive buffer overflowed and events got lost
+    bool dispatch(Handler handler, void *context);
+private:
+    int read(quint32 sequence, Handler handler, void *context, bool block);
+    int myFd;
+    quint32 mySequence;
+    QByteArray myBuffer;
+};
+
+static inline const void *nlData(const nlattr *a) { return reinterpret_cast<const char*>(a) + NLA_HDRLEN; }
+static inline int nlLength(const nlattr *a) { return a->nla_len - NLA_HDRLEN; }
+static inline quint16 nlU16(const nlattr *a) { quint16 v; memcpy(&v, nlData(a), sizeof(v)); return v; }
+static inline quint32 nlU32(const nlattr *a) { quint32 v; memcpy(&v, nlData(a), sizeof(v)); return v; }
+
+/// stores the attributes in [data, data + length) by type into tb[0..max]
+void nlParse(const nlattr **tb, int max, const void *data, int length);
+static inline void nlParseNested(const nlattr **tb, int max, const nlattr *a) { nlParse(tb, max, nlData(a), nlLength(a)); }
+
+#endif // QNETCTL_NETLINK_H
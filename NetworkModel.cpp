@@ -0,0 +1,147 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "NetworkModel.h"
+
+NetworkModel::NetworkModel(QObject *parent) : QAbstractItemModel(parent), myNextId(1), myRevision(0)
+{
+}
+
+const Connection &NetworkModel::connection(const QModelIndex &index) const
+{
+    if (isDetail(index))
+        return myConnections.at(myRows.value(index.internalId()));
+    return myConnections.at(index.row());
+}
+
+quint32 NetworkModel::revision(const QModelIndex &index) const
+{
+    if (isDetail(index))
+        return myRevisions.at(myRows.value(index.internalId()));
+    return myRevisions.at(index.row());
+}
+
+QString NetworkModel::title(const Connection &con)
+{
+    if (!con.profile.isEmpty()) return con.profile;
+    if (!con.SSID.isEmpty()) return con.SSID;
+    if (!con.MAC.isEmpty()) return con.MAC;
+    if (!con.interface.isEmpty()) return con.interface;
+    return "Nameless Network";
+}
+
+void NetworkModel::append(const QList<Connection> &connections)
+{
+    if (connections.isEmpty())
+        return;
+    const int first = myConnections.count();
+    beginInsertRows(QModelIndex(), first, first + connections.count() - 1);
+    myConnections.reserve(first + connections.count());
+    foreach (const Connection &con, connections) {
+        myRows.insert(myNextId, myConnections.count());
+        myIds << myNextId++;
+        myRevisions << ++myRevision;
+        myConnections << con;
+    }
+    endInsertRows();
+}
+
+void NetworkModel::remove(const QList<int> &rows)
+{
+    // back to front in contiguous ranges
+    for (int i = rows.count() - 1; i > -1; ) {
+        int first = i;
+        while (first > 0 && rows.at(first - 1) == rows.at(first) - 1)
+            --first;
+        remove(rows.at(first), rows.at(i));
+        i = first - 1;
+    }
+}
+
+void NetworkModel::remove(int first, int last)
+{
+    beginRemoveRows(QModelIndex(), first, last);
+    for (int i = first; i <= last; ++i)
+        myRows.remove(myIds.at(i));
+    myConnections.remove(first, last - first + 1);
+    myIds.remove(first, last - first + 1);
+    myRevisions.remove(first, last - first + 1);
+    for (int i = first; i < myIds.count(); ++i)
+        myRows[myIds.at(i)] = i;
+    endRemoveRows();
+}
+
+static bool differs(const Connection &c1, const Connection &c2)
+{
+    return c1.type != c2.type || c1.quality != c2.quality || c1.active != c2.active ||
+           c1.adHoc != c2.adHoc || c1.autoConnect != c2.autoConnect || c1.SSID != c2.SSID ||
+           c1.MAC != c2.MAC || c1.profile != c2.profile || c1.interface != c2.interface ||
+           c1.ipResolution != c2.ipResolution || c1.description != c2.description || c1.key != c2.key ||
+           c1.pinnedBSSID != c2.pinnedBSSID || c1.associated != c2.associated;
+}
+
+void NetworkModel::setConnection(int row, const Connection &con)
+{
+    if (!differs(myConnections.at(row), con))
+        return;
+    myConnections[row] = con;
+    myRevisions[row] = ++myRevision;
+    const QModelIndex idx = index(row, 0);
+    emit dataChanged(idx, idx);
+    const QModelIndex detail = index(0, 0, idx);
+    emit dataChanged(detail, detail);
+}
+
+int NetworkModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+QVariant NetworkModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || isDetail(index))
+        return QVariant();
+    return title(myConnections.at(index.row()));
+}
+
+QModelIndex NetworkModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (column)
+        return QModelIndex();
+    if (!parent.isValid())
+        return row > -1 && row < myConnections.count() ? createIndex(row, 0, quintptr(0)) : QModelIndex();
+    if (isDetail(parent) || row)
+        return QModelIndex();
+    return createIndex(0, 0, myIds.at(parent.row()));
+}
+
+QModelIndex NetworkModel::parent(const QModelIndex &index) const
+{
+    if (!isDetail(index))
+        return QModelIndex();
+    return createIndex(myRows.value(index.internalId()), 0, quintptr(0));
+}
+
+int NetworkModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+        return myConnections.count();
+    return isDetail(parent) ? 0 : 1;
+}
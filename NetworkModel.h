@@ -0,0 +1,68 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_NETWORKMODEL_H
+#define QNETCTL_NETWORKMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QVector>
+
+#include "Connection.h"
+
+/**
+ * Flat list of networks, every network has exactly one child: the detail row
+ * The delegate and QNetCtl use the typed accessors, data() only serves the DisplayRole.
+ */
+class NetworkModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    NetworkModel(QObject *parent = 0);
+    int count() const { return myConnections.count(); }
+    const Connection &connection(int row) const { return myConnections.at(row); }
+    /// for detail rows this is the connection of the parent network
+    const Connection &connection(const QModelIndex &index) const;
+    static bool isDetail(const QModelIndex &index) { return index.internalId(); }
+    /// unique stamp of the last change to the network (or its details), for render caches
+    quint32 revision(const QModelIndex &index) const;
+    static QString title(const Connection &con);
+    void append(const QList<Connection> &connections);
+    /// removes the rows, they must be sorted ascending
+    void remove(const QList<int> &rows);
+    void setConnection(int row, const Connection &con);
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &index) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+private:
+    void remove(int first, int last);
+    QVector<Connection> myConnections;
+    // detail rows carry the id of their network as internalId, that survives row shifts
+    QVector<quintptr> myIds;
+    QVector<quint32> myRevisions;
+    QHash<quintptr, int> myRows;
+    quintptr myNextId;
+    quint32 myRevision;
+};
+
+#endif // QNETCTL_NETWORKMODEL_H
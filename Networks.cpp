@@ -0,0 +1,150 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Networks.h"
+#include "Roaming.h"
+
+#include <QHash>
+#include <QRegExp>
+#include <QSet>
+
+QList<Connection> Networks::strongest(const QList<Connection> &seen)
+{
+    QHash<QString, int> byMac;
+    QList<Connection> list;
+    foreach (const Connection &con, seen) {
+        QHash<QString, int>::const_iterator it = byMac.constFind(con.MAC);
+        if (it == byMac.constEnd()) {
+            byMac.insert(con.MAC, list.count());
+            list << con;
+        } else if (con.quality > list.at(*it).quality) {
+            list[*it] = con;
+        }
+    }
+    return list;
+}
+
+QList<Connection> Networks::merge(const QList<Connection> &profiles, const QList<Connection> &scanned,
+                                  const QMap<QString, bool> &devices, const QStringList &enabledProfiles)
+{
+    // merge profiles, access points and devices - the hashes replace the linear searches
+    QList<Connection> temp = profiles;
+    QHash<QString, int> bySsid, byMac;
+    QSet<int> scannedRows; // rows that already show some BSS
+    for (int i = 0; i < temp.count(); ++i) {
+        if (!temp.at(i).SSID.isEmpty() && !bySsid.contains(temp.at(i).SSID))
+            bySsid.insert(temp.at(i).SSID, i);
+        if (!temp.at(i).MAC.isEmpty() && !byMac.contains(temp.at(i).MAC))
+            byMac.insert(temp.at(i).MAC, i);
+    }
+    foreach (const Connection &con, scanned) {
+        // the first entry that matches either the SSID or the BSSID
+        int i = con.SSID.isEmpty() ? -1 : bySsid.value(con.SSID, -1);
+        const int j = byMac.value(con.MAC, -1);
+        if (i < 0 || (j > -1 && j < i))
+            i = j;
+        if (i < 0) {
+            i = temp.count();
+            temp << con;
+            if (!con.SSID.isEmpty())
+                bySsid.insert(con.SSID, i);
+            byMac.insert(con.MAC, i);
+            scannedRows.insert(i);
+            continue;
+        }
+        Connection &it = temp[i];
+        // many APs serve one SSID: the row shows the one we're on, or else the best one
+        if (scannedRows.contains(i) && (it.associated || (!con.associated && !Roaming::isBetter(con, it))))
+            continue;
+        scannedRows.insert(i);
+        if (byMac.value(it.MAC, -1) == i)
+            byMac.remove(it.MAC);
+        it.type = con.type;
+        it.quality = con.quality;
+        it.signal = con.signal;
+        it.load = con.load;
+        it.frequency = con.frequency;
+        it.associated = con.associated;
+        it.MAC = con.MAC;
+        it.adHoc = con.adHoc;
+        if (!byMac.contains(con.MAC) || byMac.value(con.MAC) > i)
+            byMac.insert(con.MAC, i);
+    }
+    QSet<QString> interfaces;
+    foreach (const Connection &con, temp)
+        interfaces.insert(con.interface);
+    for (QMap<QString, bool>::const_iterator it = devices.constBegin(),
+                                            end = devices.constEnd(); it != end; ++it) {
+        if (interfaces.contains(it.key()))
+            continue;
+        temp << Connection();
+        Connection &con = temp.last();
+        con.interface = it.key();
+        con.type = (*it) ? Connection::Wireless : Connection::Ethernet;
+    }
+
+    const QSet<QString> enabled = enabledProfiles.toSet();
+    for (QList<Connection>::iterator it = temp.begin(), end = temp.end(); it != end; ++it) {
+        if (it->type > Connection::Ethernet && enabled.contains("netctl-auto@" + it->interface + ".service"))
+            continue; // controlled by profile attribute
+        it->autoConnect = (it->type == Connection::Ethernet && enabled.contains("netctl-ifplugd@" + it->interface + ".service")) ||
+                          enabled.contains(it->profile);
+    }
+    return temp;
+}
+
+QStringList Networks::enabledProfiles(const QStringList &units)
+{
+    static QRegExp  ifplugd_interface("netctl-ifplugd@.*\\.service"),
+                    auto_interface("netctl-auto@.*\\.service");
+    QStringList profiles;
+    foreach (const QString &unit, units) {
+        if (unit.endsWith(".service")) { // there're also the slices
+            if (!unit.indexOf(ifplugd_interface) || !unit.indexOf(auto_interface))
+                profiles << unit; // ".service" is illegal for netcfg
+            else
+                profiles << profileFromUnit(unit);
+        }
+    }
+    return profiles;
+}
+
+QString Networks::profileFromUnit(const QString &unit)
+{
+    const QString escaped = unit.section('@', 1).section(".service", 0, -2);
+    if (!escaped.contains("\\x"))
+        return escaped;
+    // systemd-escape, netctl escapes everything but [A-Za-z0-9:_.] in the instance name
+    QByteArray name;
+    const QByteArray raw = escaped.toUtf8();
+    for (int i = 0; i < raw.size(); ++i) {
+        if (raw.at(i) == '\\' && i + 3 < raw.size() && raw.at(i + 1) == 'x') {
+            bool ok;
+            const int c = raw.mid(i + 2, 2).toInt(&ok, 16);
+            if (ok) {
+                name += char(c);
+                i += 3;
+                continue;
+            }
+        }
+        name += raw.at(i);
+    }
+    return QString::fromUtf8(name);
+}
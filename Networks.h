@@ -0,0 +1,46 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_NETWORKS_H
+#define QNETCTL_NETWORKS_H
+
+#include <QMap>
+#include <QStringList>
+
+#include "Connection.h"
+
+/**
+ * The widget free part of building the network list, shared by the GUI and the --json mode
+ */
+namespace Networks
+{
+    /// the access points seen by several radios are listed once, with the one receiving them best
+    QList<Connection> strongest(const QList<Connection> &seen);
+    /// merges the profiles with the scanned access points (by SSID or BSSID), adds the devices
+    /// w/o any of them (interface -> wireless) and resolves the autoConnect state
+    QList<Connection> merge(const QList<Connection> &profiles, const QList<Connection> &scanned,
+                            const QMap<QString, bool> &devices, const QStringList &enabledProfiles);
+    /// maps the enabled netctl units to profiles, netctl-auto/ifplugd units are passed as is
+    QStringList enabledProfiles(const QStringList &units);
+    /// "netctl@home\x2dwifi.service" -> "home-wifi"
+    QString profileFromUnit(const QString &unit);
+}
+
+#endif // QNETCTL_NETWORKS_H
@@ -0,0 +1,273 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Nl80211.h"
+#include "Netlink.h"
+
+#include <QSocketNotifier>
+#include <QtDebug>
+
+#include <errno.h>
+#include <linux/genetlink.h>
+#include <linux/nl80211.h>
+#include <net/if.h>
+#include <stdio.h>
+
+static void readFamily(const nlmsghdr *nh, void *context)
+{
+    quint32 *family = static_cast<quint32*>(context); // [0]: id, [1]: "scan", [2]: "mlme" multicast group
+    const nlattr *tb[CTRL_ATTR_MAX + 1];
+    nlParse(tb, CTRL_ATTR_MAX, static_cast<const char*>(NLMSG_DATA(nh)) + GENL_HDRLEN,
+                               nh->nlmsg_len - NLMSG_HDRLEN - GENL_HDRLEN);
+    if (tb[CTRL_ATTR_FAMILY_ID])
+        family[0] = nlU16(tb[CTRL_ATTR_FAMILY_ID]);
+    if (!tb[CTRL_ATTR_MCAST_GROUPS])
+        return;
+    const nlattr *groups[32];
+    nlParseNested(groups, 31, tb[CTRL_ATTR_MCAST_GROUPS]);
+    for (int i = 1; i < 32; ++i) {
+        if (!groups[i])
+            continue;
+        const nlattr *group[CTRL_ATTR_MCAST_GRP_MAX + 1];
+        nlParseNested(group, CTRL_ATTR_MCAST_GRP_MAX, groups[i]);
+        if (!(group[CTRL_ATTR_MCAST_GRP_NAME] && group[CTRL_ATTR_MCAST_GRP_ID]))
+            continue;
+        const char *name = static_cast<const char*>(nlData(group[CTRL_ATTR_MCAST_GRP_NAME]));
+        if (!strcmp(name, NL80211_MULTICAST_GROUP_SCAN))
+            family[1] = nlU32(group[CTRL_ATTR_MCAST_GRP_ID]);
+        else if (!strcmp(name, NL80211_MULTICAST_GROUP_MLME))
+            family[2] = nlU32(group[CTRL_ATTR_MCAST_GRP_ID]);
+    }
+}
+
+Nl80211::Nl80211(QObject *parent) : QObject(parent), myNotifier(0), myFamily(0), myMlmeGroup(0)
+{
+    myCommands = new NetlinkSocket(NETLINK_GENERIC);
+    myEvents = new NetlinkSocket(NETLINK_GENERIC);
+    if (!(myCommands->isValid() && myEvents->isValid()))
+        return;
+
+    NetlinkMessage msg(GENL_ID_CTRL, 0, GENL_HDRLEN);
+    static_cast<genlmsghdr*>(msg.header())->cmd = CTRL_CMD_GETFAMILY;
+    static_cast<genlmsghdr*>(msg.header())->version = 1;
+    msg.putString(CTRL_ATTR_FAMILY_NAME, NL80211_GENL_NAME);
+    quint32 family[3] = { 0, 0, 0 };
+    if (myCommands->transact(msg, readFamily, family) || !family[0]) {
+        qDebug() << "nl80211 is not available";
+        return;
+    }
+    if (!(family[1] && myEvents->addMembership(family[1]))) {
+        qDebug() << "cannot listen to nl80211 scan events";
+        return;
+    }
+    myFamily = family[0];
+    myMlmeGroup = family[2];
+    myNotifier = new QSocketNotifier(myEvents->fd(), QSocketNotifier::Read, this);
+    connect (myNotifier, SIGNAL(activated(int)), SLOT(readEvents()));
+}
+
+Nl80211::~Nl80211()
+{
+    delete myNotifier;
+    delete myCommands;
+    delete myEvents;
+}
+
+bool Nl80211::watchMlme()
+{
+    if (myFamily && myMlmeGroup && myEvents->addMembership(myMlmeGroup))
+        return true;
+    qDebug() << "cannot listen to nl80211 mlme events"; // the scans work w/o
+    return false;
+}
+
+int Nl80211::triggerScan(const QString &device, const QList<quint32> &frequencies, const QList<QByteArray> &ssids)
+{
+    const int index = if_nametoindex(device.toLocal8Bit().constData());
+    if (!(myFamily && index))
+        return -ENODEV;
+    NetlinkMessage msg(myFamily, NLM_F_ACK, GENL_HDRLEN);
+    static_cast<genlmsghdr*>(msg.header())->cmd = NL80211_CMD_TRIGGER_SCAN;
+    msg.putU32(NL80211_ATTR_IFINDEX, index);
+    if (!frequencies.isEmpty()) {
+        const int nest = msg.beginNested(NL80211_ATTR_SCAN_FREQUENCIES);
+        for (int i = 0; i < frequencies.count(); ++i)
+            msg.putU32(i + 1, frequencies.at(i));
+        msg.endNested(nest);
+    }
+    if (!ssids.isEmpty()) {
+        const int nest = msg.beginNested(NL80211_ATTR_SCAN_SSIDS);
+        for (int i = 0; i < ssids.count(); ++i)
+            msg.put(i + 1, ssids.at(i).constData(), ssids.at(i).size());
+        msg.put(ssids.count() + 1, 0, 0); // wildcard, so the broadcasting APs answer as well
+        msg.endNested(nest);
+    }
+    const int error = myCommands->transact(msg, 0, 0);
+    if (!error || error == -EBUSY) // EBUSY: somebody else (wpa_supplicant) scans, we'll get the results as well
+        myPendingScans << index;
+    return error == -EBUSY ? 0 : error;
+}
+
+struct Event { quint8 command; int index; QString bssid; };
+
+static QString macString(const quint8 *mac)
+{
+    char text[18];
+    snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return QString::fromLatin1(text);
+}
+
+static void readEvent(const nlmsghdr *nh, void *context)
+{
+    const genlmsghdr *gh = static_cast<const genlmsghdr*>(NLMSG_DATA(nh));
+    switch (gh->cmd) {
+    case NL80211_CMD_NEW_SCAN_RESULTS: case NL80211_CMD_SCAN_ABORTED:
+    case NL80211_CMD_AUTHENTICATE: case NL80211_CMD_ASSOCIATE:
+    case NL80211_CMD_CONNECT: case NL80211_CMD_DISCONNECT:
+        break;
+    default:
+        return;
+    }
+    const nlattr *tb[NL80211_ATTR_MAX + 1];
+    nlParse(tb, NL80211_ATTR_MAX, reinterpret_cast<const char*>(gh) + GENL_HDRLEN,
+                                  nh->nlmsg_len - NLMSG_HDRLEN - GENL_HDRLEN);
+    if (!tb[NL80211_ATTR_IFINDEX])
+        return;
+    Event event = { gh->cmd, int(nlU32(tb[NL80211_ATTR_IFINDEX])), QString() };
+    if (gh->cmd == NL80211_CMD_AUTHENTICATE || gh->cmd == NL80211_CMD_ASSOCIATE) {
+        // the response frame: 24 bytes header (addr3: BSSID at 16), then the status code
+        // after algorithm and sequence (auth) or after the capabilities (assoc)
+        const nlattr *frame = tb[NL80211_ATTR_FRAME];
+        const int status = gh->cmd == NL80211_CMD_AUTHENTICATE ? 28 : 26;
+        if (!frame || tb[NL80211_ATTR_TIMED_OUT] || nlLength(frame) < status + 2)
+            return;
+        const quint8 *f = static_cast<const quint8*>(nlData(frame));
+        if (f[status] | f[status + 1])
+            return; // rejected
+        event.bssid = macString(f + 16);
+    } else if (gh->cmd == NL80211_CMD_CONNECT || gh->cmd == NL80211_CMD_DISCONNECT) {
+        if (tb[NL80211_ATTR_STATUS_CODE] && nlU16(tb[NL80211_ATTR_STATUS_CODE]))
+            return; // failed connect
+        if (tb[NL80211_ATTR_MAC] && nlLength(tb[NL80211_ATTR_MAC]) == 6)
+            event.bssid = macString(static_cast<const quint8*>(nlData(tb[NL80211_ATTR_MAC])));
+    }
+    static_cast<QList<Event>*>(context)->append(event);
+}
+
+void Nl80211::readEvents()
+{
+    QList<Event> events;
+    myEvents->dispatch(readEvent, &events);
+    foreach (const Event &event, events) {
+        char name[IF_NAMESIZE];
+        if (!if_indextoname(event.index, name))
+            continue;
+        const QString device = QString::fromLocal8Bit(name);
+        switch (event.command) {
+        case NL80211_CMD_AUTHENTICATE:
+            emit mlmeEvent(device, Authenticated, event.bssid);
+            continue;
+        case NL80211_CMD_ASSOCIATE:
+            emit mlmeEvent(device, Associated, event.bssid);
+            continue;
+        case NL80211_CMD_CONNECT:
+            emit mlmeEvent(device, Connected, event.bssid);
+            continue;
+        case NL80211_CMD_DISCONNECT:
+            emit mlmeEvent(device, Disconnected, event.bssid);
+            continue;
+        default:
+            break;
+        }
+        if (event.command == NL80211_CMD_NEW_SCAN_RESULTS)
+            emit scanResultsAvailable(device);
+        if (!myPendingScans.remove(event.index))
+            continue; // not ours
+        if (event.command == NL80211_CMD_NEW_SCAN_RESULTS)
+            emit scanFinished(device);
+        else
+            emit scanFailed(device);
+    }
+}
+
+static void readInformationElements(WifiBss &bss, const quint8 *ie, int length)
+{
+    static const quint8 wpaOui[4] = { 0x00, 0x50, 0xf2, 0x01 };
+    while (length >= 2 && ie[1] + 2 <= length) {
+        const quint8 id = ie[0], size = ie[1];
+        if (id == 0) // SSID
+            bss.ssid = QByteArray(reinterpret_cast<const char*>(ie + 2), size);
+        else if (id == 11 && size >= 5) // BSS Load: station count (2), channel utilization (1), capacity (2)
+            bss.load = ie[4];
+        else if (id == 48) // RSN
+            bss.rsn = true;
+        else if (id == 221 && size >= 4 && !memcmp(ie + 2, wpaOui, 4)) // vendor specific, MS WPA
+            bss.wpa = true;
+        length -= size + 2;
+        ie += size + 2;
+    }
+}
+
+static void readBss(const nlmsghdr *nh, void *context)
+{
+    const genlmsghdr *gh = static_cast<const genlmsghdr*>(NLMSG_DATA(nh));
+    const nlattr *tb[NL80211_ATTR_MAX + 1];
+    nlParse(tb, NL80211_ATTR_MAX, reinterpret_cast<const char*>(gh) + GENL_HDRLEN,
+                                  nh->nlmsg_len - NLMSG_HDRLEN - GENL_HDRLEN);
+    if (!tb[NL80211_ATTR_BSS])
+        return;
+    const nlattr *bt[NL80211_BSS_MAX + 1];
+    nlParseNested(bt, NL80211_BSS_MAX, tb[NL80211_ATTR_BSS]);
+    if (!bt[NL80211_BSS_BSSID] || nlLength(bt[NL80211_BSS_BSSID]) != 6)
+        return;
+
+    WifiBss bss;
+    bss.bssid = QByteArray(static_cast<const char*>(nlData(bt[NL80211_BSS_BSSID])), 6);
+    if (bt[NL80211_BSS_FREQUENCY])
+        bss.frequency = nlU32(bt[NL80211_BSS_FREQUENCY]);
+    if (bt[NL80211_BSS_CAPABILITY])
+        bss.capability = nlU16(bt[NL80211_BSS_CAPABILITY]);
+    if (bt[NL80211_BSS_SEEN_MS_AGO])
+        bss.age = nlU32(bt[NL80211_BSS_SEEN_MS_AGO]);
+    if (bt[NL80211_BSS_SIGNAL_MBM])
+        bss.signal = qint32(nlU32(bt[NL80211_BSS_SIGNAL_MBM]));
+    if (bt[NL80211_BSS_STATUS])
+        bss.associated = nlU32(bt[NL80211_BSS_STATUS]) == NL80211_BSS_STATUS_ASSOCIATED;
+    const nlattr *ies = bt[NL80211_BSS_INFORMATION_ELEMENTS];
+    if (!ies)
+        ies = bt[NL80211_BSS_BEACON_IES];
+    if (ies)
+        readInformationElements(bss, static_cast<const quint8*>(nlData(ies)), nlLength(ies));
+    static_cast<WifiBssList*>(context)->append(bss);
+}
+
+WifiBssList Nl80211::scanResults(const QString &device)
+{
+    WifiBssList list;
+    const int index = if_nametoindex(device.toLocal8Bit().constData());
+    if (!(myFamily && index))
+        return list;
+    NetlinkMessage msg(myFamily, NLM_F_DUMP, GENL_HDRLEN);
+    static_cast<genlmsghdr*>(msg.header())->cmd = NL80211_CMD_GET_SCAN;
+    msg.putU32(NL80211_ATTR_IFINDEX, index);
+    if (int error = myCommands->transact(msg, readBss, &list))
+        qDebug() << "Failed to dump scan results" << device << error;
+    return list;
+}
@@ -0,0 +1,70 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_NL80211_H
+#define QNETCTL_NL80211_H
+
+#include <QObject>
+#include <QSet>
+
+#include "WifiBss.h"
+
+class NetlinkSocket;
+class QSocketNotifier;
+
+/**
+ * Generic netlink nl80211 client
+ * Triggers scans and reads the kernels BSS table w/o forking "iw" and parsing its output.
+ * On request it also listens to the MLME events, ie. who authenticates and associates with which BSS.
+ */
+class Nl80211 : public QObject
+{
+    Q_OBJECT
+public:
+    enum MlmeEvent { Authenticated = 1, Associated, Connected, Disconnected };
+    Nl80211(QObject *parent = 0);
+    ~Nl80211();
+    bool isValid() const { return myFamily; }
+    /// subscribes to the MLME events for mlmeEvent() - every (re)association of every radio wakes us then
+    bool watchMlme();
+    /// returns 0 or -errno, scanFinished or scanFailed will follow the former
+    /// empty frequencies scan all channels, ssids are actively probed for (hidden networks)
+    int triggerScan(const QString &device, const QList<quint32> &frequencies = QList<quint32>(),
+                    const QList<QByteArray> &ssids = QList<QByteArray>());
+    /// dumps the kernels BSS cache for the device, this needs no privileges
+    WifiBssList scanResults(const QString &device);
+signals:
+    void scanFinished(QString device);
+    void scanFailed(QString device);
+    /// any scan finished, also those of wpa_supplicant or other processes
+    void scanResultsAvailable(QString device);
+    /// successful steps only, a rejected or timed out attempt just doesn't show up
+    void mlmeEvent(QString device, int event, QString bssid);
+private slots:
+    void readEvents();
+private:
+    NetlinkSocket *myCommands, *myEvents;
+    QSocketNotifier *myNotifier;
+    quint16 myFamily;
+    quint32 myMlmeGroup;
+    QSet<int> myPendingScans;
+};
+
+#endif // QNETCTL_NL80211_H
@@ -0,0 +1,116 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "ProfileIndex.h"
+#include "paths.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QSet>
+#include <QTimer>
+#include <QtDebug>
+
+#include <sys/stat.h>
+
+ProfileIndex::ProfileIndex(QObject *parent) : QObject(parent)
+{
+    myWatcher = new QFileSystemWatcher(this);
+    myUpdateTimer = new QTimer(this);
+    myUpdateTimer->setSingleShot(true);
+    myUpdateTimer->setInterval(100); // writes come in bursts, editors rename, ...
+    connect (myUpdateTimer, SIGNAL(timeout()), SLOT(update()));
+    // the directory only reports added/removed files, the file watches catch in place writes
+    connect (myWatcher, SIGNAL(directoryChanged(const QString&)), myUpdateTimer, SLOT(start()));
+    connect (myWatcher, SIGNAL(fileChanged(const QString&)), myUpdateTimer, SLOT(start()));
+    if (!myWatcher->addPath(gs_profilePath))
+        qDebug() << "cannot watch" << gs_profilePath << "- profile changes by others will go unnoticed";
+}
+
+QList<Connection> ProfileIndex::profiles() const
+{
+    QList<Connection> list;
+    for (QMap<QString, Entry>::const_iterator it = myEntries.constBegin(),
+                                              end = myEntries.constEnd(); it != end; ++it)
+        list << it->connection;
+    return list;
+}
+
+void ProfileIndex::setActive(const QString &profile, bool active)
+{
+    QMap<QString, Entry>::iterator it = myEntries.find(profile);
+    if (it != myEntries.end())
+        it->connection.active = active;
+}
+
+void ProfileIndex::switchTo(const QString &profile)
+{
+    QMap<QString, Entry>::const_iterator target = myEntries.constFind(profile);
+    if (target == myEntries.constEnd())
+        return;
+    const QString interface = target->connection.interface;
+    for (QMap<QString, Entry>::iterator it = myEntries.begin(), end = myEntries.end(); it != end; ++it) {
+        if (it->connection.interface == interface)
+            it->connection.active = (it.key() == profile);
+    }
+}
+
+bool ProfileIndex::update()
+{
+    myUpdateTimer->stop();
+    bool dirty = false;
+    QStringList watch;
+    const QSet<QString> files = myWatcher->files().toSet();
+    QMap<QString, Entry> entries;
+    // same selection as "netctl list": regular files, no hidden ones or backups
+    foreach (const QString &name, QDir(gs_profilePath).entryList(QDir::Files)) {
+        if (name.endsWith('~'))
+            continue;
+        const QString path = gs_profilePath + name;
+        struct stat st;
+        if (stat(QFile::encodeName(path).constData(), &st))
+            continue;
+        Stamp stamp;
+        stamp.mtime = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        stamp.size = st.st_size;
+        stamp.inode = st.st_ino;
+
+        Entry &entry = entries[name];
+        QMap<QString, Entry>::const_iterator old = myEntries.constFind(name);
+        if (old != myEntries.constEnd() && !(old->stamp != stamp)) {
+            entry = *old;
+        } else {
+            entry.connection = Connection(name);
+            entry.stamp = stamp;
+            if (old != myEntries.constEnd())
+                entry.connection.active = old->connection.active;
+            dirty = true;
+        }
+        if (!files.contains(path))
+            watch << path; // new file or replaced (renamed over) one - its watch is gone
+    }
+    dirty = dirty || entries.count() != myEntries.count(); // removals
+    myEntries = entries;
+    if (!watch.isEmpty())
+        myWatcher->addPaths(watch);
+    if (dirty)
+        emit changed();
+    return dirty;
+}
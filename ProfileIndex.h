@@ -0,0 +1,69 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_PROFILEINDEX_H
+#define QNETCTL_PROFILEINDEX_H
+
+#include <QMap>
+#include <QObject>
+
+#include "Connection.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+/**
+ * Filename keyed index of the parsed profiles in gs_profilePath
+ * The directory and the profiles are watched (inotify) and only files whose inode, size or
+ * mtime changed get re-parsed. The activation state is kept in memory, netctl only has to be
+ * asked once.
+ */
+class ProfileIndex : public QObject
+{
+    Q_OBJECT
+public:
+    ProfileIndex(QObject *parent = 0);
+    /// sorted by name
+    QList<Connection> profiles() const;
+    void setActive(const QString &profile, bool active);
+    /// netctl switch-to stops all other profiles on the interface
+    void switchTo(const QString &profile);
+public slots:
+    /// stats the profiles, re-parses the changed ones and emits changed() if there were any
+    bool update();
+signals:
+    void changed();
+private:
+    struct Stamp {
+        qint64 mtime, size;
+        quint64 inode;
+        bool operator!=(const Stamp &other) const
+        { return mtime != other.mtime || size != other.size || inode != other.inode; }
+    };
+    struct Entry {
+        Connection connection;
+        Stamp stamp;
+    };
+    QMap<QString, Entry> myEntries;
+    QFileSystemWatcher *myWatcher;
+    QTimer *myUpdateTimer;
+};
+
+#endif // QNETCTL_PROFILEINDEX_H
@@ -0,0 +1,183 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_PROTOCOL_H
+#define QNETCTL_PROTOCOL_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QList>
+#include <QString>
+
+/**
+ * GUI <-> helper protocol
+ * The GUI emits batch(version, requests) carrying N requests, the tool answers every request
+ * with exactly one result, matched by request id. Results are sent in batchReply(version, results)
+ * calls as they complete, so a scan does not wait for a slow "netctl switch-to" of the same batch.
+ * While netctl connects, the tool reports the steps it sees as progress(version, Progress) calls.
+ * Both lists are QDataStream serialized, bump Version whenever the layout changes.
+ */
+namespace Protocol
+{
+    enum { Version = 6 };
+
+    enum Command {
+        Invalid = 0,
+        SwitchToProfile, StopProfile,
+        EnableProfile, DisableProfile, EnableService, DisableService,
+        RemoveProfile, WriteProfile,
+        ScanWifi,
+        Quit,
+        DumpTrace,
+        Roam
+    };
+
+    /// what Result::payload holds
+    enum Payload {
+        NoPayload = 0,
+        BssList,        // QDataStream'ed WifiBssList (nl80211)
+        IwScanDump,     // raw "iw dev X scan" stdout
+        TraceEvents     // the helpers Trace::events()
+    };
+
+    /// the steps of a SwitchToProfile, as the kernel reports them
+    enum Phase {
+        NoPhase = 0,
+        LinkUp, Authenticated, Associated, Carrier, AddressAssigned,
+        Connected, ConnectFailed // netctl exited
+    };
+
+    struct Request {
+        Request() : id(0), command(Invalid) {}
+        quint32 id;
+        qint32 command;
+        QString target;     // profile, service or device
+        QString data;       // the profile contents for WriteProfile, the BSSID for Roam
+        QByteArray payload; // ScanTarget for ScanWifi
+    };
+
+    /// restricts a ScanWifi to some channels, probing for some (hidden) SSIDs - empty: full sweep
+    struct ScanTarget {
+        QList<quint32> frequencies;
+        QList<QByteArray> ssids;
+        bool isEmpty() const { return frequencies.isEmpty() && ssids.isEmpty(); }
+    };
+
+    struct Result {
+        Result() : id(0), command(Invalid), ok(false), payloadType(NoPayload) {}
+        quint32 id;
+        qint32 command;
+        QString target;
+        bool ok;
+        QString message;    // stdout or the error
+        qint32 payloadType;
+        QByteArray payload;
+    };
+
+    struct Progress {
+        Progress() : id(0), phase(NoPhase), time(0) {}
+        quint32 id;         // of the SwitchToProfile request
+        qint32 phase;
+        qint64 time;        // Trace::now(), CLOCK_MONOTONIC is the same clock in both processes
+        QString device;
+        QString detail;     // the BSSID, the address
+    };
+
+    typedef QList<Request> RequestList;
+    typedef QList<Result> ResultList;
+
+    // in the namespace, so the QList<T> stream templates find them by ADL
+    inline QDataStream &operator<<(QDataStream &s, const Request &r)
+    {
+        return s << r.id << r.command << r.target << r.data << r.payload;
+    }
+
+    inline QDataStream &operator>>(QDataStream &s, Request &r)
+    {
+        return s >> r.id >> r.command >> r.target >> r.data >> r.payload;
+    }
+
+    inline QDataStream &operator<<(QDataStream &s, const Result &r)
+    {
+        return s << r.id << r.command << r.target << r.ok << r.message << r.payloadType << r.payload;
+    }
+
+    inline QDataStream &operator>>(QDataStream &s, Result &r)
+    {
+        return s >> r.id >> r.command >> r.target >> r.ok >> r.message >> r.payloadType >> r.payload;
+    }
+
+    inline QDataStream &operator<<(QDataStream &s, const Progress &p)
+    {
+        return s << p.id << p.phase << p.time << p.device << p.detail;
+    }
+
+    inline QDataStream &operator>>(QDataStream &s, Progress &p)
+    {
+        return s >> p.id >> p.phase >> p.time >> p.device >> p.detail;
+    }
+
+    inline QDataStream &operator<<(QDataStream &s, const ScanTarget &t)
+    {
+        return s << t.frequencies << t.ssids;
+    }
+
+    inline QDataStream &operator>>(QDataStream &s, ScanTarget &t)
+    {
+        return s >> t.frequencies >> t.ssids;
+    }
+
+    inline const char *name(qint32 command)
+    {
+        static const char *names[] = { "invalid", "switch_to_profile", "stop_profile",
+                                       "enable_profile", "disable_profile", "enable_service", "disable_service",
+                                       "remove_profile", "write_profile", "scan_wifi", "quit", "dump_trace", "roam" };
+        if (command < Invalid || command > Roam)
+            command = Invalid;
+        return names[command];
+    }
+
+    inline const char *phaseName(qint32 phase)
+    {
+        static const char *names[] = { "none", "link_up", "authenticated", "associated", "carrier",
+                                       "address_assigned", "connected", "connect_failed" };
+        if (phase < NoPhase || phase > ConnectFailed)
+            phase = NoPhase;
+        return names[phase];
+    }
+
+    template <typename T> QByteArray pack(const T &value)
+    {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << value;
+        return data;
+    }
+
+    template <typename T> T unpack(const QByteArray &data)
+    {
+        T value;
+        QDataStream stream(data);
+        stream >> value;
+        return value;
+    }
+}
+
+#endif // QNETCTL_PROTOCOL_H
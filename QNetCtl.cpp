@@ -20,6 +20,20 @@
 
 #include "QNetCtl.h"
 #include "QNetCtl_dbus.h"
+#include "JsonCli.h"
+#include "LinkMonitor.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "NetworkModel.h"
+#include "Networks.h"
+#include "Nl80211.h"
+#include "ProfileIndex.h"
+#include "ScanCache.h"
+#include "ScanScheduler.h"
+#include "Snapshot.h"
+#include "SystemdUnits.h"
+#include "Trace.h"
+#include "WifiBss.h"
 #include "ui_ipconfig.h"
 #include "ui_settings.h"
 
@@ -29,6 +43,7 @@
 #include <QDialog>
 #include <QDir>
 #include <QFile>
+#include <QHash>
 #include <QHBoxLayout>
 #include <QIcon>
 #include <QMessageBox>
@@ -36,13 +51,22 @@
 #include <QPainter>
 #include <QProcess>
 #include <QPushButton>
+#include <QSet>
 #include <QSettings>
+#include <QShortcut>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QStaticText>
 #include <QTimer>
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include <QTreeView>
 #include <QVBoxLayout>
+#include <QVector>
 
+#include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <QtDebug>
 
@@ -76,96 +100,21 @@ protected:
     }\
     QString _var_(QString::fromLocal8Bit(proc->readAllStandardOutput()))
 
+// export QNETCTL_METRICS=/var/lib/node_exporter/textfile_collector/qnetctl.prom to have the metrics
+// written every 15 seconds - durations are recorded in ms and exported in seconds
+static const QVector<qint64> gs_requestBuckets = QVector<qint64>() << 50 << 100 << 250 << 500 << 1000 << 2500
+                                                                   << 5000 << 10000 << 30000;
+static const QVector<qint64> gs_scanBuckets = QVector<qint64>() << 250 << 500 << 1000 << 2000 << 4000 << 8000 << 16000;
+static const QVector<qint64> gs_connectBuckets = QVector<qint64>() << 250 << 500 << 1000 << 2000 << 4000 << 8000
+                                                                   << 16000 << 32000;
+static const QVector<qint64> gs_bssBuckets = QVector<qint64>() << 0 << 1 << 2 << 5 << 10 << 20 << 50 << 100 << 200;
+// ms, the helper bringing a link up and a full sweep take a fraction - a reply that did not come by then won't
+static const qint64 gs_scanTimeout = 30000;
+
 // #define TOOL(_T_) mySettings->_T_->text()
 
 #include "paths.h"
 
-enum Roles { IsDetailRole = Qt::UserRole + 1, TypeRole, QualityRole, ConnectedRole, AdHocRole,
-             MacRole, ProfileRole, SsidRole, DescriptionRole, InterfaceRole, IPRole, KeyRole,
-             AutoconnectRole };
-
-Connection::Connection(const Connection &other)
-{
-    type         = other.type;
-    SSID         = other.SSID;
-    profile      = other.profile;
-    quality      = other.quality;
-    MAC          = other.MAC;
-    active       = other.active;
-    description  = other.description;
-    interface    = other.interface;
-    adHoc        = other.adHoc;
-    ipResolution = other.ipResolution;
-    key          = other.key;
-    autoConnect  = other.autoConnect;
-}
-
-Connection::Connection(QString p)
-{
-    profile = p;
-    autoConnect = true;
-    type = Unknown;
-    active = false;
-    quality = 0;
-    adHoc = false;
-    QFile file(gs_profilePath + profile);
-    if (!file.exists()) {
-        qDebug() << "attempted to read non existing profile:" << profile;
-        return;
-    }
-    if (!file.open(QIODevice::ReadOnly|QIODevice::Text)) {
-        qDebug() << "attempted to read protected profile:" << profile;
-        return;
-    }
-    Type sec = Unknown;
-    while (!file.atEnd()) {
-        QString line = file.readLine();
-        line = line.section('#', 0, 0).trimmed(); // drop commented stuff
-        if (line.startsWith("Description")) {
-            description = line.section('=', 1);
-        } else if (line.startsWith("Connection")) {
-            QString con(line.section('=', 1));
-            if (con == "ethernet") {
-                quality = 100;
-                type = Ethernet;
-            } else if (con == "wireless") {
-                type = Wireless;
-            }
-            // else if ... TODO: more useless connection types
-        } else if (line.startsWith("Interface")) {
-            interface = line.section('=', 1);
-        } else if (line.startsWith("ESSID")) {
-            SSID = line.section('=', 1);
-        } else if (line.startsWith("Security")) {
-            QString secs(line.section('=', 1));
-            if (secs == "wep")
-                sec = WEP;
-            else if (secs == "wpa")
-                sec = WPA;
-        } else if (line.startsWith("Key")) {
-            key = line.section('=', 1);
-        } else if (line.startsWith("IP")) {
-            QString ip = line.section('=', 1).trimmed();
-            if (ipResolution.isEmpty() || ip == "dhcp") // dhcp trumps Address & Gateway definition
-                ipResolution = ip;
-        } else if (line.startsWith("Address")) {
-            if (ipResolution != "dhcp")
-                ipResolution.prepend(line.section('=', 1).trimmed());
-        } else if (line.startsWith("Gateway")) {
-            if (ipResolution != "dhcp")
-                ipResolution.append(';' + line.section('=', 1).trimmed());
-        } else if (line.startsWith("ExcludeAuto")) {
-            autoConnect = line.section('=', 1).trimmed() != "yes";
-        } else if (line.startsWith("Priority")) {
-            // int = line.section('=', 1).trimmed().toInt();
-            void(0);
-        }
-    }
-    file.close();
-    if (type == Wireless && sec)
-        type = sec;
-}
-
 static inline QColor mix(QColor c1, QColor c2)
 {
     c1.setRed  ((c1.red()   + c2.red())  /2);
@@ -177,7 +126,22 @@ static inline QColor mix(QColor c1, QColor c2)
 class NetworkDelegate : public QAbstractItemDelegate
 {
 public:
-    NetworkDelegate( QWidget *parent = 0 ) : QAbstractItemDelegate(parent) {}
+    NetworkDelegate( QWidget *parent, const SignalHistory *history ) : QAbstractItemDelegate(parent),
+                                                                      myHistory(history), myLineHeight(0)
+    {
+        updateFonts();
+        parent->installEventFilter(this);
+    }
+
+    bool eventFilter(QObject *, QEvent *e)
+    {
+        if (e->type() == QEvent::FontChange || e->type() == QEvent::PaletteChange) {
+            myCache.clear();
+            myLineHeight = 0;
+            updateFonts();
+        }
+        return false;
+    }
 
     void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &idx) const
     {
@@ -186,9 +150,11 @@ public:
 
         const QPalette &pal = option.palette;
         QRect rect = option.rect;
-        const bool isDetails = idx.data(IsDetailRole).toBool();
-        QModelIndex index = isDetails ? idx.parent() : idx;
-        if ( option.state & QStyle::State_Selected ) {
+        const bool isDetails = NetworkModel::isDetail(idx);
+        const bool selected = option.state & QStyle::State_Selected;
+        painter->save();
+        painter->setClipRect(rect); // static texts aren't clipped on their own
+        if ( selected ) {
             painter->fillRect( rect, pal.color(QPalette::Highlight) );
             painter->setPen( pal.color(QPalette::HighlightedText) );
         } else if (isDetails) {
@@ -198,92 +164,198 @@ public:
             painter->setPen( pal.color(QPalette::Base) );
         }
 
-        QFont fnt = static_cast<QWidget*>(parent())->font();
-        fnt.setBold(true);
-
         if (isDetails)
             rect.adjust(16, 1, -4, -4);
         else
             rect.adjust(4, 0, -4, 0);
-        int textFlags = Qt::TextSingleLine | Qt::TextHideMnemonic;
+        const RenderCache &cache = renderCache(idx, pal, rect.width());
         if (isDetails) {
-            QString left = index.data(MacRole).toString();
-            if (left.isEmpty())
-                left = tr("Device: ") + index.data(InterfaceRole).toString();
-            else
-                left = index.data(InterfaceRole).toString() + " -> " + left;
-            painter->drawText(rect, textFlags | Qt::AlignLeft|Qt::AlignTop, left);
-            painter->drawText(rect, textFlags | Qt::AlignLeft|Qt::AlignBottom, "IP: " + index.data(IPRole).toString());
-            painter->drawText(rect, textFlags | Qt::AlignRight|Qt::AlignTop, index.data(SsidRole).toString());
-
-            Connection::Type t = (Connection::Type)index.data(TypeRole).toInt();
-            QString ps;
-            QColor c = Qt::green;
-            switch (t) {
-                default:
-                case Connection::Ethernet:
-                    if (index.data(QualityRole).toInt() > 0) {
-                        ps = "Wired";
-                    } else {
-                        ps = index.data(ProfileRole).toString().isEmpty() ? "Unconfigured wired connection" : "Unwired";
-                        c = Qt::red;
-                    }
-                    break;
-                case Connection::Wireless:
-                    c = Qt::red;
-                    ps = "Insecure";
-                    break;
-                case Connection::WEP:
-                    c = Qt::yellow;
-                    ps = "Security: WEP";
-                    break;
-                case Connection::WPA:
-                    ps = "Security: WPA";
-                    break;
-                case Connection::WPA1:
-                    ps = "Security: WPA1";
-                    break;
-                case Connection::WPA2:
-                    ps = "Security: WPA2";
-                    break;
+            painter->setFont(myFont);
+            draw(painter, rect, Qt::AlignLeft|Qt::AlignTop, cache.left);
+            draw(painter, rect, Qt::AlignLeft|Qt::AlignBottom, cache.ip);
+            draw(painter, rect, Qt::AlignRight|Qt::AlignTop, cache.ssid);
+            painter->setFont(myBoldFont);
+            painter->setPen(cache.securityColor[selected]);
+            draw(painter, rect, Qt::AlignRight|Qt::AlignBottom, cache.security);
+            // not cached, the history moves on w/o the row changing
+            const Connection &con = static_cast<const NetworkModel*>(idx.model())->connection(idx);
+            if (!con.MAC.isEmpty() && myHistory->contains(con.MAC)) {
+                const QRect spark(rect.x() + rect.width()*3/8, rect.y(), rect.width()/4, rect.height());
+                drawSparkline(painter, spark, myHistory->samples(con.MAC), cache.securityColor[selected]);
+                // more than a dB per minute is a trend, less is jitter
+                const double trend = myHistory->trend(con.MAC);
+                const QChar arrow(trend > 1.0 ? 0x2197 : trend < -1.0 ? 0x2198 : 0x2192);
+                painter->drawText(QRect(spark.right() + 4, spark.top(), myLineHeight, spark.height()),
+                                  Qt::AlignLeft|Qt::AlignVCenter, arrow);
             }
-            painter->setFont(fnt);
-            painter->setPen( mix(c, painter->pen().color()) );
-            painter->drawText(rect, textFlags | Qt::AlignRight|Qt::AlignBottom, ps);
         } else {
-            int quality = qMax(0, index.data(QualityRole).toInt());
-            QString qualityString = QString::number(quality) + "%  ";
-            int i = 0;
-            for (; i < qRound(quality/20.0); ++i)
-                qualityString += QChar(0x2605);
-            for (; i < 5; ++i)
-                qualityString += QChar(0x2606);
-            painter->drawText(rect, textFlags | Qt::AlignRight, qualityString);
-
-            fnt.setPointSize(fnt.pointSize() * 1.2);
-            painter->setFont(fnt);
-            textFlags |= Qt::AlignVCenter;
-            QString name = QChar(index.data(AdHocRole).toBool() ? 0x21C4 : 0x2192) + QString(" ");
-            name += " " + index.data().toString();
-            if (index.data(ConnectedRole).toBool())
-                name = name + " " + QChar(0x26A1);
-            else if (!index.data(ProfileRole).toString().isEmpty())
-                name = name + " " + QChar(0x2714);
-            painter->drawText(rect, textFlags | Qt::AlignLeft, name);
+            painter->setFont(myFont);
+            draw(painter, rect, Qt::AlignRight|Qt::AlignTop, cache.quality);
+            painter->setFont(myTitleFont);
+            draw(painter, rect, Qt::AlignLeft|Qt::AlignVCenter, cache.name);
         }
-        painter->setFont(static_cast<QWidget*>(parent())->font());
+        painter->restore();
     }
 
     QSize sizeHint( const QStyleOptionViewItem &option, const QModelIndex &index ) const
     {
-        if (index.data(IsDetailRole).toBool())
-            return QSize(128, QFontMetrics(option.font).height() * 2 + 5);
-        return QSize(128, QFontMetrics(option.font).height() * 3 / 2);
+        if (!myLineHeight)
+            myLineHeight = QFontMetrics(option.font).height();
+        if (NetworkModel::isDetail(index))
+            return QSize(128, myLineHeight * 2 + 5);
+        return QSize(128, myLineHeight * 3 / 2);
     }
+private:
+    struct RenderCache {
+        int width;                              // the texts are elided to it
+        QStaticText quality, name;              // network row
+        QStaticText left, ip, ssid, security;   // detail row
+        QColor securityColor[2];                // mixed with the regular and the selected text color
+    };
+
+    static void draw(QPainter *painter, const QRect &rect, Qt::Alignment align, const QStaticText &text)
+    {
+        const QSizeF size = text.size();
+        QPointF pos(rect.topLeft());
+        if (align & Qt::AlignRight)
+            pos.setX(rect.right() + 1 - size.width());
+        if (align & Qt::AlignBottom)
+            pos.setY(rect.bottom() + 1 - size.height());
+        else if (align & Qt::AlignVCenter)
+            pos.setY(rect.top() + (rect.height() - size.height())/2);
+        painter->drawStaticText(pos, text);
+    }
+
+    // the raw readings thin, their average solid, on a fixed [-90,-30] dBm scale
+    static void drawSparkline(QPainter *painter, const QRect &rect, const QVector<SignalHistory::Sample> &samples,
+                              const QColor &color)
+    {
+        if (samples.count() < 2 || rect.width() < 16)
+            return;
+        const qint64 t0 = samples.first().time, span = qMax(qint64(1), samples.last().time - t0);
+        QPolygonF raw, smoothed;
+        raw.reserve(samples.count());
+        smoothed.reserve(samples.count());
+        foreach (const SignalHistory::Sample &sample, samples) {
+            const qreal x = rect.left() + rect.width() * qreal(sample.time - t0) / span;
+            raw << QPointF(x, rect.bottom() - rect.height() * qBound(0.0, (sample.signal + 90) / 60.0, 1.0));
+            smoothed << QPointF(x, rect.bottom() - rect.height() * qBound(0.0, (sample.smoothed + 90) / 60.0, 1.0));
+        }
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        QColor c = painter->pen().color();
+        c.setAlpha(96);
+        painter->setPen(QPen(c, 1));
+        painter->drawPolyline(raw);
+        painter->setPen(QPen(color, 2));
+        painter->drawPolyline(smoothed);
+        painter->restore();
+    }
+
+    void updateFonts()
+    {
+        myFont = myBoldFont = myTitleFont = static_cast<QWidget*>(parent())->font();
+        myBoldFont.setBold(true);
+        myTitleFont.setBold(true);
+        myTitleFont.setPointSize(myTitleFont.pointSize() * 1.2);
+    }
+
+    static void prepare(QStaticText &text, const QString &string, const QFont &font, int width)
+    {
+        text.setTextFormat(Qt::PlainText);
+        text.setText(QFontMetrics(font).elidedText(string, Qt::ElideRight, qMax(0, width)));
+        text.prepare(QTransform(), font);
+    }
+
+    // the strings, layouts and colors only change with the row data (its revision), the width or font and palette
+    const RenderCache &renderCache(const QModelIndex &idx, const QPalette &pal, int width) const
+    {
+        const NetworkModel *model = static_cast<const NetworkModel*>(idx.model());
+        const quint32 revision = model->revision(idx);
+        QHash<quint32, RenderCache>::const_iterator it = myCache.constFind(revision);
+        if (it != myCache.constEnd() && it->width == width)
+            return *it;
+
+        if (myCache.count() > 2*model->count() + 32)
+            myCache.clear(); // outdated revisions
+
+        const Connection &con = model->connection(idx);
+        RenderCache &cache = myCache[revision];
+        cache.width = width;
+        // detail row: the left and right column leave the middle to the sparkline and its arrow
+        const int leftWidth = width*3/8 - 4, rightWidth = width*3/8 - 8 - myLineHeight;
+
+        int quality = qMax(0, con.quality);
+        QString qualityString = QString::number(quality) + "%  ";
+        int i = 0;
+        for (; i < qRound(quality/20.0); ++i)
+            qualityString += QChar(0x2605);
+        for (; i < 5; ++i)
+            qualityString += QChar(0x2606);
+        prepare(cache.quality, qualityString, myFont, width);
+
+        QString name = QChar(con.adHoc ? 0x21C4 : 0x2192) + QString(" ");
+        name += " " + NetworkModel::title(con);
+        if (con.active)
+            name = name + " " + QChar(0x26A1);
+        else if (!con.profile.isEmpty())
+            name = name + " " + QChar(0x2714);
+        // next to the quality, which sits above its vertical center
+        prepare(cache.name, name, myTitleFont, width - cache.quality.size().width() - myLineHeight/2);
+
+        QString left = con.MAC;
+        if (left.isEmpty())
+            left = tr("Device: ") + con.interface;
+        else
+            left = con.interface + " -> " + left;
+        prepare(cache.left, left, myFont, leftWidth);
+        prepare(cache.ip, "IP: " + con.ipResolution, myFont, leftWidth);
+        prepare(cache.ssid, con.SSID, myFont, rightWidth);
+
+        QString ps;
+        QColor c = Qt::green;
+        switch (con.type) {
+            default:
+            case Connection::Ethernet:
+                if (con.quality > 0) {
+                    ps = "Wired";
+                } else {
+                    ps = con.profile.isEmpty() ? "Unconfigured wired connection" : "Unwired";
+                    c = Qt::red;
+                }
+                break;
+            case Connection::Wireless:
+                c = Qt::red;
+                ps = "Insecure";
+                break;
+            case Connection::WEP:
+                c = Qt::yellow;
+                ps = "Security: WEP";
+                break;
+            case Connection::WPA:
+                ps = "Security: WPA";
+                break;
+            case Connection::WPA1:
+                ps = "Security: WPA1";
+                break;
+            case Connection::WPA2:
+                ps = "Security: WPA2";
+                break;
+        }
+        prepare(cache.security, ps, myBoldFont, rightWidth);
+        cache.securityColor[0] = mix(c, pal.color(QPalette::Text));
+        cache.securityColor[1] = mix(c, pal.color(QPalette::HighlightedText));
+        return cache;
+    }
+
+    mutable QHash<quint32, RenderCache> myCache;
+    const SignalHistory *myHistory;
+    QFont myFont, myBoldFont, myTitleFont;
+    mutable int myLineHeight;
 };
 
 
-QNetCtl::QNetCtl() : QTabWidget(), iWaitForIwScan(0), myProfileConfig(0)
+QNetCtl::QNetCtl() : QTabWidget(), myScanRound(0), myRequestId(0), iHaveHelper(false), myProfileConfig(0)
 {
     new QNetCtlAdaptor(this);
     const QString service = "org.archlinux.qnetctl-" + QString::number(QCoreApplication::applicationPid());
@@ -296,12 +368,37 @@ QNetCtl::QNetCtl() : QTabWidget(), iWaitForIwScan(0), myProfileConfig(0)
     myUpdateTimer->setSingleShot(true);
     connect (myUpdateTimer, SIGNAL(timeout()), SLOT(buildTree()));
 
-    myRescanTimer = new QTimer(this);
-    myRescanTimer->setInterval(8000); // rescan every 8 seconds
-    myRescanTimer->setSingleShot(false);
-    connect (myRescanTimer, SIGNAL(timeout()), SLOT(scanWifi()));
-    connect (myRescanTimer, SIGNAL(timeout()), SLOT(checkDevices()));
-    myRescanTimer->start();
+    // the GUI and helper trace of the recent requests, for chrome://tracing
+    new QShortcut(QKeySequence("Ctrl+Shift+T"), this, SLOT(exportTrace()));
+
+    myMetricsPath = QString::fromLocal8Bit(qgetenv("QNETCTL_METRICS"));
+    if (!myMetricsPath.isEmpty()) {
+        QTimer *metricsTimer = new QTimer(this);
+        connect (metricsTimer, SIGNAL(timeout()), SLOT(writeMetrics()));
+        metricsTimer->start(15000);
+    }
+
+    myRequestTimer = new QTimer(this);
+    myRequestTimer->setInterval(0);
+    myRequestTimer->setSingleShot(true);
+    connect (myRequestTimer, SIGNAL(timeout()), SLOT(flushRequests()));
+
+    myScanScheduler = new ScanScheduler(this);
+    connect (myScanScheduler, SIGNAL(scan()), SLOT(scanWifi()));
+    myScanScheduler->kick("startup");
+
+    myLinkMonitor = new LinkMonitor(this);
+    connect (myLinkMonitor, SIGNAL(linkChanged(QString, bool, bool, bool)), SLOT(updateLink(QString, bool, bool, bool)));
+    connect (myLinkMonitor, SIGNAL(linkRemoved(QString)), SLOT(removeLink(QString)));
+
+    myNl80211 = new Nl80211(this);
+    connect (myNl80211, SIGNAL(scanResultsAvailable(QString)), SLOT(refreshWifi(QString)));
+
+    mySystemdUnits = new SystemdUnits("netctl*", this);
+    connect (mySystemdUnits, SIGNAL(enabledUnits(QStringList)), SLOT(parseEnabledNetworks(QStringList)));
+
+    myProfileIndex = new ProfileIndex(this);
+    connect (myProfileIndex, SIGNAL(changed()), SLOT(updateProfiles()));
 
     myAutoConnectUpdateTimer = new QTimer(this);
     myAutoConnectUpdateTimer->setInterval(30000); // wait 30 seconds, it's just for reboots etc.
@@ -313,18 +410,27 @@ QNetCtl::QNetCtl() : QTabWidget(), iWaitForIwScan(0), myProfileConfig(0)
     addTab(w = new QWidget(this), icn, icn.isNull() ? tr("Networks") : QString());
     setTabToolTip(0, tr("Networks"));
     QVBoxLayout *l = new QVBoxLayout(w);
-    l->addWidget(myNetworks = new QTreeWidget(w));
+    l->addWidget(myNetworks = new QTreeView(w));
+    myNetworks->setModel(myModel = new NetworkModel(myNetworks));
     myNetworks->setCursor(Qt::PointingHandCursor);
     myNetworks->setExpandsOnDoubleClick(true);
-    connect (myNetworks, SIGNAL(currentItemChanged(QTreeWidgetItem*, QTreeWidgetItem*)),
-                         SLOT(showSelected(QTreeWidgetItem*, QTreeWidgetItem*)));
+    connect (myNetworks->selectionModel(), SIGNAL(currentChanged(const QModelIndex&, const QModelIndex&)),
+                                           SLOT(showSelected(const QModelIndex&, const QModelIndex&)));
     myNetworks->setRootIsDecorated(false);
     myNetworks->setIconSize( QSize(32, 32) );
     myNetworks->setHeaderHidden(true);
     myNetworks->setIndentation(0);
     myNetworks->setVerticalScrollMode( QAbstractItemView::ScrollPerPixel );
     myNetworks->setAnimated( true );
-    myNetworks->setItemDelegate(new NetworkDelegate(myNetworks));
+    myNetworks->setItemDelegate(new NetworkDelegate(myNetworks, &mySignalHistory));
+
+    l->addWidget(myProgressLabel = new QLabel(w));
+    myProgressLabel->setWordWrap(true);
+    myProgressLabel->hide();
+    myProgressTimer = new QTimer(this);
+    myProgressTimer->setInterval(10000); // long enough to read where the time went
+    myProgressTimer->setSingleShot(true);
+    connect (myProgressTimer, SIGNAL(timeout()), myProgressLabel, SLOT(hide()));
 
     l->addWidget(myErrorLabel = new ErrorLabel(w));
     myErrorLabel->hide();
@@ -355,16 +461,69 @@ QNetCtl::QNetCtl() : QTabWidget(), iWaitForIwScan(0), myProfileConfig(0)
     mySettings = new Ui::Settings;
     mySettings->setupUi(w);
     connect (mySettings->leverage, SIGNAL(textChanged(const QString &)), SLOT(verifyPath()));
+    connect (mySettings->scanTTL, SIGNAL(valueChanged(int)), SLOT(setScanTTL(int)));
 
     readConfig();
+    restoreSnapshot();
+
+    // the rest runs in parallel and reconciles the list as it arrives, nothing waits for the helper
+    // (which may be stuck in a password dialog) - the requests are queued until it reports in
     QProcess *tool = new QProcess(this);
     QString leverage = mySettings->leverage->text();
     leverage.replace("%w", QString::number(winId())).replace("%p", QString::number(QCoreApplication::applicationPid()));
     tool->start(leverage + " " + TOOL(qnetctl) + " " + QString(getenv("DBUS_SESSION_BUS_ADDRESS")) +
                            " " + QDBusConnection::sessionBus().name() + " " + service, QIODevice::NotOpen);
-    query(TOOL(systemctl) + " list-unit-files", SLOT(parseEnabledNetworks()));
-    readProfiles();
-    scanWifi();
+    mySystemdUnits->refresh();
+    query(TOOL(netctl) + " list", SLOT(parseProfiles())); // only the activation state, the list stays usable
+    checkDevices(); // carriers
+    for (QMap<QString, bool>::const_iterator it = myDevices.constBegin(),
+                                            end = myDevices.constEnd(); it != end; ++it) {
+        if (*it)
+            refreshWifi(it.key()); // needs no root, the active scan follows with the scheduler
+    }
+}
+
+void QNetCtl::restoreSnapshot()
+{
+    Snapshot snapshot;
+    snapshot.load(); // empty on the first launch
+    // the kernel answers the link dump right away, so no device of the last session sneaks in
+    myDevices = myLinkMonitor->links();
+    myEnabledProfiles = snapshot.enabledProfiles;
+    myKnownFrequencies = snapshot.knownFrequencies;
+    for (QMap<QString, QList<Connection> >::const_iterator it = snapshot.scans.constBegin(),
+                                                          end = snapshot.scans.constEnd(); it != end; ++it) {
+        if (!myDevices.value(it.key()))
+            continue; // the dongle is gone
+        // the APs age out with the regular TTL unless a scan confirms them
+        ScanCache *cache = new ScanCache;
+        cache->setTTL(scanTTL());
+        cache->update(*it);
+        myScanCaches.insert(it.key(), cache);
+    }
+    myProfileIndex->blockSignals(true);
+    myProfileIndex->update();
+    foreach (const QString &profile, snapshot.activeProfiles)
+        myProfileIndex->setActive(profile, true);
+    myProfileIndex->blockSignals(false);
+    myProfiles = myProfileIndex->profiles();
+    buildTree(); // right away, this is the first paint
+}
+
+void QNetCtl::saveSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.enabledProfiles = myEnabledProfiles;
+    foreach (const Connection &con, myProfiles) {
+        if (con.active)
+            snapshot.activeProfiles << con.profile;
+    }
+    for (QMap<QString, ScanCache*>::const_iterator it = myScanCaches.constBegin(),
+                                                  end = myScanCaches.constEnd(); it != end; ++it)
+        snapshot.scans.insert(it.key(), (*it)->connections());
+    snapshot.knownFrequencies = myKnownFrequencies;
+    if (!snapshot.save())
+        qDebug() << "failed to write the snapshot";
 }
 
 #define WRITE_CMD(_S_, _C_)\
@@ -373,18 +532,34 @@ if (mySettings->_C_->text().isEmpty())\
 else\
     s.setValue(_S_, mySettings->_C_->text())
 
+void QNetCtl::showEvent(QShowEvent *event)
+{
+    myScanScheduler->setActive(true);
+    QTabWidget::showEvent(event);
+}
+
+void QNetCtl::hideEvent(QHideEvent *event)
+{
+    myScanScheduler->setActive(false); // nobody looks
+    QTabWidget::hideEvent(event);
+}
+
 void QNetCtl::closeEvent(QCloseEvent *event)
 {
     QSettings s("QNetCtl");
     s.setValue("Width", width());
     s.setValue("Height", height());
     WRITE_CMD("Leverage", leverage);
+    s.setValue("ScanTTL", mySettings->scanTTL->value());
+    s.setValue("Roaming", mySettings->roaming->isChecked());
     if (myAutoConnectUpdateTimer->isActive()) {
         myAutoConnectUpdateTimer->stop(); // shortcut
         if (!updateAutoConnects())
             return; // do not close, user shall fix his setup.
     }
-    emit request("quit", "");
+    saveSnapshot();
+    writeMetrics();
+    quitTool();
     QWidget::closeEvent(event);
 }
 
@@ -404,6 +579,21 @@ void QNetCtl::readConfig()
     resize(w, h);
     QString cmd;
     READ_CMD("Leverage", QString(), leverage);
+    mySettings->scanTTL->setValue(s.value("ScanTTL", 30).toInt());
+    mySettings->roaming->setChecked(s.value("Roaming", true).toBool());
+    setScanTTL(mySettings->scanTTL->value());
+}
+
+void QNetCtl::setScanTTL(int)
+{
+    const int ttl = scanTTL();
+    foreach (ScanCache *cache, myScanCaches)
+        cache->setTTL(ttl);
+}
+
+int QNetCtl::scanTTL() const
+{
+    return qMax(mySettings->scanTTL->value()*1000, 2*myScanScheduler->interval());
 }
 
 void QNetCtl::query(QString cmd, const char *slot)
@@ -413,6 +603,7 @@ void QNetCtl::query(QString cmd, const char *slot)
     env.remove("LANG");
     QProcess *proc = new QProcess(this);
     proc->setProcessEnvironment(env);
+    proc->setProperty("QNetCtlStarted", Trace::now());
     connect (proc, SIGNAL(finished(int, QProcess::ExitStatus)), slot);
     connect (proc, SIGNAL(finished(int, QProcess::ExitStatus)), proc, SLOT(deleteLater()));
     proc->start(cmd, QIODevice::ReadOnly);
@@ -420,187 +611,259 @@ void QNetCtl::query(QString cmd, const char *slot)
 
 void QNetCtl::connectNetwork()
 {
-    QTreeWidgetItem *item = currentItem();
-    if (!item)
+    const int row = currentRow();
+    if (row < 0)
         return;
-    QString profile = item->data(0, ProfileRole).toString();
+    QString profile = myModel->connection(row).profile;
     if (profile.isEmpty() && !editProfile()) {
         return;
     }
     setEnabled(false);
-    emit request("switch_to_profile", profile);
+    myConnects.insert(post(Protocol::SwitchToProfile, profile), profile);
 }
 
 void QNetCtl::disconnectNetwork()
 {
-    QTreeWidgetItem *item = currentItem();
-    if (!item)
+    const int row = currentRow();
+    if (row < 0)
         return;
-    QString profile = item->data(0, ProfileRole).toString();
+    QString profile = myModel->connection(row).profile;
     if (profile.isEmpty() && !editProfile()) {
         return;
     }
     setEnabled(false);
 //     qDebug() << "stop_profile" << profile;
-    emit request("stop_profile", profile);
+    post(Protocol::StopProfile, profile);
 }
 
 
 void QNetCtl::checkDevices()
 {
-    if (!(currentIndex() || TOOL(ip).isEmpty()))
-        query(TOOL(ip) + " link show", SLOT(parseDevices()));
+    myLinkMonitor->refresh(); // no fork, the links arrive through updateLink()
 }
 
-QTreeWidgetItem *QNetCtl::currentItem() const
+int QNetCtl::currentRow() const
 {
-    QTreeWidgetItem *item = myNetworks->currentItem();
-    if (!item)
-        return NULL;
-    if (item->parent() && item->parent() != myNetworks->invisibleRootItem())
-        return item->parent();
-    return item;
+    QModelIndex index = myNetworks->currentIndex();
+    if (!index.isValid())
+        return -1;
+    if (index.parent().isValid())
+        index = index.parent();
+    return index.row();
 }
 
-void QNetCtl::parseDevices()
+void QNetCtl::updateLink(QString interface, bool up, bool carrier, bool wireless)
 {
-    READ_STDOUT(links, "Failed to read network devices:");
-
-    QStringList linkList = links.split('\n');
-    links.clear();
-    bool checkWifi = false;
-    foreach (const QString &link, linkList) {
-        if (link.contains("BROADCAST")) {
-            const bool broken = link.contains("NO-CARRIER"); // dead ethernet
-            QString interface = link.section(':', 1, 1).trimmed();
-            if (!myDevices.contains(interface)) {
-                myDevices.insert(interface, false);
-                checkWifi = true; // could be Wireless, iw will tell
-            }
-            for (QList<Connection>::iterator it = myProfiles.begin(),
-                                            end = myProfiles.end(); it != end; ++it) {
-                if (it->interface == interface) {
-                    if ((it->quality < 0) != broken)
-                        it->quality = -(it->quality);
-                    break;
-                }
-            }
+    if (myDevices.value(interface, !wireless) != wireless) {
+        myDevices.insert(interface, wireless);
+        if (wireless && iHaveHelper && !isScanning(interface)) {
+            myScanningDevices.insert(interface, Trace::now());
+            post(Protocol::ScanWifi, interface);
         }
     }
-    if (checkWifi && !TOOL(iw).isEmpty()) {
-        query(TOOL(iw) + " dev", SLOT(parseWifiDevs()));
+    if (carrier)
+        myCarriers << interface;
+    else if (myCarriers.remove(interface))
+        myScanScheduler->kick("lost link on " + interface);
+    const bool broken = up && !carrier; // dead ethernet
+    for (QList<Connection>::iterator it = myProfiles.begin(),
+                                    end = myProfiles.end(); it != end; ++it) {
+        if (it->interface == interface) {
+            if ((it->quality < 0) != broken)
+                it->quality = -(it->quality);
+            break;
+        }
     }
     updateTree();
 }
 
-void QNetCtl::parseEnabledNetworks()
+void QNetCtl::removeLink(QString interface)
 {
-    static QRegExp  ifplugd_interface("netctl-ifplugd@.*\\.service"),
-                    auto_interface("netctl-auto@.*\\.service");
-    READ_STDOUT(services, "Failed to list systemd services");
-    QStringList serviceList = services.split('\n');
-    services.clear();
-    myEnabledProfiles.clear();
-    foreach (const QString &l, serviceList) {
-        if (!l.trimmed().endsWith("enabled"))
-            continue;
-        QString line = l.section(" ", 0, 0);
-        if (line.startsWith("netctl") && line.endsWith(".service")) { // there're also the slices
-            if (!line.indexOf(ifplugd_interface) || !line.indexOf(auto_interface))
-                myEnabledProfiles << line; // ".service" is illegal for netcfg
-            else {
-                line = line.section('@', 1);
-                myEnabledProfiles << line.section(".service", 0, -2);
-            }
-        }
-    }
-    updateTree();
+    myCarriers.remove(interface);
+    myScanningDevices.remove(interface);
+    delete myScanCaches.take(interface); // the USB dongle took its networks along
+    myScanCoverage.remove(interface);
+    myRoaming.forget(interface);
+    myTargetedScans.remove(interface);
+    if (myDevices.remove(interface))
+        updateTree();
 }
 
-void QNetCtl::parseWifiDevs() {
-    READ_STDOUT(wireless, "Failed to list wireless devices");
-    QStringList wirelessList = wireless.split('\n');
-    wireless.clear();
-    foreach (const QString &l, wirelessList) {
-        const QString line = l.trimmed();
-        if (line.startsWith("Interface")) {
-            const QString interface = line.section(' ', 1);
-            if (!myDevices.value(interface, false)) {
-                myDevices[interface] = true;
-                ++iWaitForIwScan;
-                // query is ok, this is triggered from parseDevices only if iw exists
-                emit request("scan_wifi", interface);
-            }
-        }
-    }
+void QNetCtl::parseEnabledNetworks(QStringList units)
+{
+    myEnabledProfiles = Networks::enabledProfiles(units);
+    updateTree();
 }
 
-
 void QNetCtl::scanWifi()
 {
-    if (currentIndex() || iWaitForIwScan || TOOL(iw).isEmpty())
-        return; // this can last depending on the wifi chip - don't trigger a new scan
-    // TODO: ensure ip link set <dev> up
+    if (currentIndex() || TOOL(iw).isEmpty())
+        return;
+    // the kernel keeps the results of the last scan (ours or wpa_supplicants) for 30 seconds
+    // reading them is cheap and needs no root, so only every 3rd round wakes the radio and the helper
+    // - unless the scheduler backed off so far that the cache will be gone by then
+    // w/o the helper (yet) there's only the cache, helperReady() kicks the first active round
+    const bool active = iHaveHelper && (!myNl80211->isValid() || !(myScanRound++ % 3) || myScanScheduler->interval() > 10000);
+    Metrics::gauge("qnetctl_scan_interval_seconds", "Current interval of the scan scheduler").set(myScanScheduler->interval() / 1000);
     for (QMap<QString, bool>::const_iterator it = myDevices.constBegin(),
                                             end = myDevices.constEnd(); it != end; ++it) {
-        if (*it) {
-            ++iWaitForIwScan;
-            emit request("scan_wifi", it.key());
+        if (!active && *it && (myScanCaches.contains(it.key()) || !iHaveHelper)) {
+            if (myNl80211->isValid())
+                refreshWifi(it.key());
+            continue;
         }
+        // this can last depending on the wifi chip - don't trigger a new scan on a busy one
+        // but don't let it hold back the others either
+        if (*it && !isScanning(it.key())) {
+            if (myScanningDevices.contains(it.key()))
+                LOG(Warning, "no scan results from %s in %d s, scanning again", qPrintable(it.key()), int(gs_scanTimeout / 1000));
+            myScanningDevices.insert(it.key(), Trace::now());
+            const Protocol::ScanTarget target = scanTarget(it.key());
+            myScanCoverage.insert(it.key(), target.frequencies.toSet());
+            post(Protocol::ScanWifi, it.key(), QString(), target.isEmpty() ? QByteArray() : Protocol::pack(target));
+        }
+    }
+}
+
+bool QNetCtl::isScanning(const QString &device) const
+{
+    // a lost reply (the helper died or never started the scan) must not stop the scans on device for good
+    QHash<QString, qint64>::const_iterator it = myScanningDevices.constFind(device);
+    return it != myScanningDevices.constEnd() && (Trace::now() - *it) / 1000000 < gs_scanTimeout;
+}
+
+Protocol::ScanTarget QNetCtl::scanTarget(const QString &device)
+{
+    // a full sweep over all 2.4/5/6 GHz channels takes seconds, the channels where the saved
+    // networks were seen are done in a fraction - every 3rd scan is a full one to find the rest
+    Protocol::ScanTarget target;
+    int &targeted = myTargetedScans[device];
+    if (targeted >= 2) {
+        targeted = 0;
+        return target;
+    }
+    QSet<quint32> frequencies;
+    foreach (const Connection &profile, myProfiles) {
+        if (profile.type >= Connection::Wireless && (profile.interface.isEmpty() || profile.interface == device))
+            frequencies |= myKnownFrequencies.value(profile.SSID);
+    }
+    if (frequencies.isEmpty()) {
+        targeted = 0;
+        return target; // nothing known yet
     }
+    ++targeted;
+    target.frequencies = frequencies.toList();
+    qSort(target.frequencies);
+    return target;
 }
 
-void QNetCtl::parseWifiScan(QString networks)
+void QNetCtl::parseWifiScan(QString device, QByteArray networks)
 {
-    --iWaitForIwScan;
+    myScanningDevices.remove(device);
     myNetworks->setEnabled(true);
+    const QList<Connection> wlans = Connection::parseIwScan(networks);
+    applyScan(device, wlans);
+}
 
-    QStringList networkList = networks.split("\nBSS");
+void QNetCtl::applyScan(const QString &device, const QList<Connection> &scanned)
+{
+    ScanCache *&cache = myScanCaches[device];
+    if (!cache)
+        cache = new ScanCache;
+    cache->setTTL(scanTTL()); // follows the scheduler backing off or speeding up
+    // remember where the saved networks live, for targeted scans
+    QSet<QString> saved;
+    foreach (const Connection &profile, myProfiles) {
+        if (profile.type >= Connection::Wireless && !profile.SSID.isEmpty())
+            saved << profile.SSID;
+    }
+    foreach (const Connection &con, scanned) {
+        if (con.frequency && saved.contains(con.SSID))
+            myKnownFrequencies[con.SSID] << con.frequency;
+    }
+    Metrics::histogram("qnetctl_scan_bss", "Access points per scan result, active scans and kernel cache reads",
+                       gs_bssBuckets, 1.0, Metrics::label("radio", device)).observe(scanned.count());
+    // rank and show the average, a single reading jumps by several dB between scans
+    QList<Connection> scan = scanned;
+    for (QList<Connection>::iterator it = scan.begin(), end = scan.end(); it != end; ++it) {
+        if (it->MAC.isEmpty() || !it->signal)
+            continue;
+        mySignalHistory.add(it->MAC, it->signal, it->age);
+        it->quality = mySignalHistory.quality(it->MAC, it->quality);
+        it->signal = qRound(mySignalHistory.smoothed(it->MAC));
+    }
+    const ScanCache::Delta delta = cache->update(scan, myScanCoverage.value(device));
+    myScanScheduler->observe(delta.significant);
+    if (!delta.isEmpty())
+        updateTree();
+    else
+        myNetworks->viewport()->update(); // the sparklines
+    roam(device);
+}
 
-    if (networkList.isEmpty())
+void QNetCtl::roam(const QString &device)
+{
+    if (!mySettings->roaming->isChecked() || !myScanCaches.contains(device))
         return;
-
-    myWLANs.clear();
-    foreach (const QString &network, networkList) {
-        QStringList networkFields = network.split('\n', QString::SkipEmptyParts);
-        if (networkFields.isEmpty())
+    foreach (const Connection &profile, myProfiles) {
+        // AP= pins the profile to one BSS, wpa_supplicant wouldn't go anywhere else
+        if (!profile.active || profile.interface != device || profile.type < Connection::Wireless ||
+            profile.adHoc || !profile.pinnedBSSID.isEmpty())
             continue;
-        myWLANs << Connection();
-        Connection &connection = myWLANs.last();
-
-        connection.type = Connection::Wireless;
-        bool first = true;
-        foreach (const QString &f, networkFields) {
-            const QString field = f.simplified();
-            if (first) {
-                connection.MAC = field;
-                connection.MAC = connection.MAC.remove("BSS ").section(' ', 0, 0).section('(', 0, 0);
-                first = false;
-            } else if (field.startsWith("capability")) {
-                if (field.contains(" Privacy "))
-                    connection.type = qMax(connection.type, Connection::WEP);
-                if (field.contains(" IBSS "))
-                    connection.adHoc = true;
-            } else if (field.startsWith("signal:")) {
-                const double d = field.section(':', 1).trimmed().section(' ', 0, 0).toDouble();
-                connection.quality = qMax(0, qMin(100, int(5*(d+90)))); // [-90,-70] -> [0,100]
-            } else if (field.startsWith("SSID:")) {
-                connection.SSID = field.section(':', 1).trimmed();
-            } else if (field.startsWith("RSN:")) {
-                connection.type = qMax(connection.type, Connection::WPA2);
-            } else if (field.startsWith("WPA:")) {
-                connection.type = qMax(connection.type, Connection::WPA1);
-            }
-        }
+        const QString bssid = myRoaming.candidate(device, profile.SSID, myScanCaches.value(device)->connections());
+        if (bssid.isEmpty())
+            return;
+        LOG(Info, "%s: moving %s to %s", qPrintable(device), qPrintable(profile.profile), qPrintable(bssid));
+        Metrics::counter("qnetctl_roams_total", "Requested moves to a better BSS of the same network").inc();
+        post(Protocol::Roam, device, bssid);
+        return;
     }
-    updateTree();
+}
+
+QList<Connection> QNetCtl::scannedNetworks() const
+{
+    if (myScanCaches.count() == 1)
+        return myScanCaches.first()->connections();
+    QList<Connection> seen;
+    foreach (const ScanCache *cache, myScanCaches)
+        seen << cache->connections();
+    return Networks::strongest(seen);
+}
+
+void QNetCtl::scanResults(QString device, QByteArray bss)
+{
+    myScanningDevices.remove(device);
+    myNetworks->setEnabled(true);
+    WifiBssList bssList;
+    QDataStream stream(bss);
+    stream >> bssList;
+    applyBss(device, bssList);
+}
+
+void QNetCtl::refreshWifi(QString device)
+{
+    if (!myDevices.value(device) || isScanning(device))
+        return; // the results of our own scan are on their way
+    // the kernel cache is only fresh where the last scan looked
+    applyBss(device, myNl80211->scanResults(device));
+}
+
+void QNetCtl::applyBss(const QString &device, const WifiBssList &bssList)
+{
+    QList<Connection> wlans;
+    foreach (const WifiBss &b, bssList)
+        wlans << Connection::fromBss(b);
+    applyScan(device, wlans);
 }
 
 bool QNetCtl::editProfile()
 {
-    QTreeWidgetItem *item = currentItem();
-    if (!item)
+    int row = currentRow();
+    if (row < 0)
         return false;
+    Connection con = myModel->connection(row);
+    // the dialog runs an event loop, buildTree() may shift or remove the row meanwhile
+    const QPersistentModelIndex index = myModel->index(row, 0);
 
     QDialog dlg;
     if (!myProfileConfig) {
@@ -612,10 +875,10 @@ bool QNetCtl::editProfile()
 //     myProfileConfig->key->setEchoMode(QLineEdit::Password);
     myProfileConfig->staticGroup->hide();
 
-    QString oldProfileName = item->data(0, ProfileRole).toString();
+    QString oldProfileName = con.profile;
     myProfileConfig->profile->setText(oldProfileName);
 
-    const QString ip = item->data(0, IPRole).toString();
+    const QString ip = con.ipResolution;
     myProfileConfig->dhcp->setChecked(ip == "dhcp");
     if (!myProfileConfig->dhcp->isChecked()) {
         myProfileConfig->ipv4->setText(ip.section(';', 0));
@@ -623,14 +886,14 @@ bool QNetCtl::editProfile()
             myProfileConfig->gateway4->setText(ip.section(';', 1));
     }
 
-    const int type = item->data(0, TypeRole).toInt();
-    bool autoConnect = item->data(0, AutoconnectRole).toBool();
+    const int type = con.type;
+    bool autoConnect = con.autoConnect;
     myProfileConfig->autoConnect->setChecked(autoConnect);
     if (type < Connection::WEP) {
         myProfileConfig->key->hide();
         myProfileConfig->keyLabel->hide();
     } else if (type == Connection::WEP) {
-        const QString key = item->data(0, KeyRole).toString();
+        const QString key = con.key;
         if (key.startsWith("\\\""))
             myProfileConfig->key->setText(key.mid(2));
         else
@@ -639,41 +902,43 @@ bool QNetCtl::editProfile()
                                             "It must match the <b>WEP</b> key stored in the accesspoint<br>"
                                             "<br><b>Example:</b> 1A23B4C56D<br>"));
     } else { // WPA
-        myProfileConfig->key->setText(item->data(0, KeyRole).toString());
+        myProfileConfig->key->setText(con.key);
         myProfileConfig->key->setToolTip(tr("The key is a random string of alphanumeric and special chars.<br>"
                                             "It must match the <b>WPA</b> key stored in the accesspoint<br>"
                                             "<br><b>Example:</b> Th15K3y15N0t53cur3<br>"));
     }
     dlg.adjustSize();
 
-    if (dlg.exec() && (type < Connection::WEP || !myProfileConfig->key->text().isEmpty())) {
+    if (dlg.exec() && index.isValid() && (type < Connection::WEP || !myProfileConfig->key->text().isEmpty())) {
+        row = index.row();
         QString key = myProfileConfig->key->text();
         if (type == Connection::WEP && (key.length() == 10 || key.length() == 26)) // WEP hex key needs to be escaped
             key.prepend('"');
         if (key.startsWith('"')) // needs to be escaped
             key.prepend('\\');
         QString profile = myProfileConfig->profile->text();
-        item->setData(0, ProfileRole, profile);
+        con.profile = profile;
         if (autoConnect != myProfileConfig->autoConnect->isChecked()) {
             autoConnect = myProfileConfig->autoConnect->isChecked();
-            item->setData(0, AutoconnectRole, autoConnect);
+            con.autoConnect = autoConnect;
             myEnabledProfiles.removeAll(profile);
             myEnabledProfiles.removeAll(oldProfileName);
             if (autoConnect) {
                 myEnabledProfiles << profile;
-                emit request("enable_profile", oldProfileName);
-                emit request("enable_profile", profile);
+                post(Protocol::EnableProfile, oldProfileName);
+                post(Protocol::EnableProfile, profile);
             } else {
-                emit request("disable_profile", oldProfileName);
-                emit request("disable_profile", profile);
+                post(Protocol::DisableProfile, oldProfileName);
+                post(Protocol::DisableProfile, profile);
             }
             autoConnect = true; // for update
         }
         if (myProfileConfig->dhcp->isChecked())
-            item->setData(0, IPRole, "dhcp");
+            con.ipResolution = "dhcp";
         else
-            item->setData(0, IPRole, myProfileConfig->ipv4->text() + ';' + myProfileConfig->gateway4->text());
-        writeProfile(item, key);
+            con.ipResolution = myProfileConfig->ipv4->text() + ';' + myProfileConfig->gateway4->text();
+        myModel->setConnection(row, con);
+        writeProfile(con, key);
         if (autoConnect)
             myAutoConnectUpdateTimer->start();
         return true;
@@ -683,17 +948,17 @@ bool QNetCtl::editProfile()
 
 void QNetCtl::forgetProfile()
 {
-    QTreeWidgetItem *item = currentItem();
-    if (!item)
+    const int row = currentRow();
+    if (row < 0)
         return;
-    QString profile = item->data(0, ProfileRole).toString();
+    QString profile = myModel->connection(row).profile;
     if (profile.isEmpty())
         return;
     QMessageBox::StandardButton a = QMessageBox::warning(this, tr("Delete Profile %1 ?").arg(profile),
                                                          tr("Do you really want to delete the profile %1?").arg(profile),
                                                          QMessageBox::Yes|QMessageBox::No, QMessageBox::No);
     if (a == QMessageBox::Yes) {
-        emit request("remove_profile", profile);
+        post(Protocol::RemoveProfile, profile);
     }
 }
 
@@ -703,77 +968,207 @@ void QNetCtl::readProfiles()
     query(TOOL(netctl) + " list", SLOT(parseProfiles()));
 }
 
-void QNetCtl::reply(QString tag, QString information)
+void QNetCtl::batchReply(uint version, QByteArray data)
 {
-//     qDebug() << "reply" << tag << information;
-    if (information.startsWith("ERROR")) {
-        myErrorLabel->setText(tag + " | " + information);
+    if (version != Protocol::Version) {
+        LOG(Error, "helper speaks protocol version %u, we need %d", version, int(Protocol::Version));
+        myErrorLabel->setText(tr("The helper speaks protocol version %1, we need %2 - mismatching installation?")
+                              .arg(version).arg(int(Protocol::Version)));
         myErrorLabel->show();
-    } else if (tag == "switch_to_profile" || tag == "stop_profile" ||
-               tag == "remove_profile" || tag == "write_profile") {
-        readProfiles();
-    } else if (tag == "scan_wifi") {
-        parseWifiScan(information);
-    } else if (tag == "enable_profile") {
-        // TODO?
-    } else if (tag == "enable_service") {
-        // TODO?
+        return;
     }
-    else if (tag == "disable_profile") {
-        // TODO?
-    } else if (tag == "disable_service") {
-        // TODO?
+    TRACE_SPAN("handle reply");
+    const Protocol::ResultList results = Protocol::unpack<Protocol::ResultList>(data);
+    foreach (const Protocol::Result &result, results) {
+//         qDebug() << "reply" << result.id << Protocol::name(result.command) << result.target << result.message;
+        if (!result.ok) {
+            LOG(Warning, "%s %s failed: %s", Protocol::name(result.command),
+                         qPrintable(result.target), qPrintable(result.message));
+            myErrorLabel->setText(QString(Protocol::name(result.command)) + ' ' + result.target + " | " + result.message);
+            myErrorLabel->show();
+        }
+        switch (result.command) {
+        case Protocol::SwitchToProfile:
+        case Protocol::StopProfile:
+            myConnects.remove(result.id); // in case the helper couldn't watch it
+            if (!result.ok) {
+                readProfiles(); // we don't know what netctl left behind
+                break;
+            }
+            if (result.command == Protocol::SwitchToProfile)
+                myProfileIndex->switchTo(result.target);
+            else
+                myProfileIndex->setActive(result.target, false);
+            setEnabled(true);
+            updateProfiles();
+            break;
+        case Protocol::RemoveProfile:
+        case Protocol::WriteProfile:
+            if (result.ok)
+                myProfileIndex->update(); // usually the watcher was faster
+            break;
+        case Protocol::ScanWifi:
+            if (result.payloadType == Protocol::BssList)
+                scanResults(result.target, result.payload);
+            else if (result.payloadType == Protocol::IwScanDump)
+                parseWifiScan(result.target, result.payload);
+            else
+                myScanningDevices.remove(result.target); // failed, don't block further scans
+            break;
+        case Protocol::DumpTrace:
+            writeTrace(result.payload);
+            break;
+        case Protocol::Roam:
+            // wpa_cli exits fine and says FAIL, eg. if wpa_supplicant doesn't know the BSS (yet)
+            if (result.ok && result.message.trimmed() != "OK")
+                LOG(Warning, "roaming %s failed: %s", qPrintable(result.target), qPrintable(result.message.trimmed()));
+            break;
+        default:
+            break;
+        }
+        Trace::record(Trace::AsyncEnd, Protocol::name(result.command), result.id);
+        countReply(result);
     }
 }
 
 void QNetCtl::parseProfiles()
 {
     READ_STDOUT(profiles, "Failed to list profiles:");
+    const qint64 started = proc->property("QNetCtlStarted").toLongLong();
+    Trace::record(Trace::Complete, "netctl list", 0, QString(), started, Trace::now() - started);
 
     QStringList profileList = profiles.split('\n', QString::SkipEmptyParts);
-    if (profileList.isEmpty()) {
-        setEnabled(true);
-        return;
-    }
     profiles.clear();
-    myProfiles.clear();
+    // the files are indexed on their own, netctl is only asked which profiles are active
+    myProfileIndex->blockSignals(true);
+    myProfileIndex->update();
+    myProfileIndex->blockSignals(false);
     foreach (const QString &profile, profileList) {
-        if (profile.startsWith("* ")) {
-            myProfiles << Connection(profile.mid(2).trimmed());
-            myProfiles.last().active = true;
-        } else {
-            myProfiles << Connection(profile.trimmed());
-        }
+        if (profile.startsWith("* "))
+            myProfileIndex->setActive(profile.mid(2).trimmed(), true);
+        else
+            myProfileIndex->setActive(profile.trimmed(), false);
     }
     setEnabled(true);
+    updateProfiles();
+}
+
+void QNetCtl::updateProfiles()
+{
+    myProfiles = myProfileIndex->profiles();
+    Metrics::counter("qnetctl_profile_updates_total", "Changes of the profiles or their activation state").inc();
+    Metrics::gauge("qnetctl_profiles", "Known netctl profiles").set(myProfiles.count());
     checkDevices();
     updateTree();
     QTimer::singleShot(300, this, SLOT(updateConnectButton()));
 }
 
+void QNetCtl::helperReady(uint version)
+{
+    if (version != Protocol::Version) {
+        LOG(Error, "helper speaks protocol version %u, we need %d", version, int(Protocol::Version));
+        myErrorLabel->setText(tr("The helper speaks protocol version %1, we need %2 - mismatching installation?")
+                              .arg(version).arg(int(Protocol::Version)));
+        myErrorLabel->show();
+        return;
+    }
+    LOG(Info, "helper is ready, %d requests pending", myRequests.count());
+    iHaveHelper = true;
+    Metrics::counter("qnetctl_helper_starts_total", "Helper processes that reported in").inc();
+    flushRequests(); // whatever piled up while it was starting
+    myScanScheduler->kick("helper ready"); // until now, there was only the kernel cache
+}
+
+void QNetCtl::progress(uint version, QByteArray data)
+{
+    if (version != Protocol::Version)
+        return; // batchReply() tells
+    const Protocol::Progress progress = Protocol::unpack<Protocol::Progress>(data);
+    const QString profile = myConnects.value(progress.id);
+    const qint64 started = myRequestStarts.value(progress.id);
+    if (profile.isNull() || !started)
+        return;
+    const qint64 ms = (progress.time - started) / 1000000;
+    // per profile, a slow DHCP server or a distant AP should show up as what it is
+    Metrics::histogram("qnetctl_connect_phase_seconds", "From the connect request to each of its phases",
+                       gs_connectBuckets, 1000.0, Metrics::label("profile", profile) + ',' +
+                       Metrics::label("phase", Protocol::phaseName(progress.phase))).observe(ms);
+
+    QString phase;
+    switch (progress.phase) {
+    case Protocol::LinkUp:          phase = tr("link up"); break;
+    case Protocol::Authenticated:   phase = tr("authenticated"); break;
+    case Protocol::Associated:      phase = tr("associated"); break;
+    case Protocol::Carrier:         phase = tr("carrier"); break;
+    case Protocol::AddressAssigned: phase = tr("address %1").arg(progress.detail); break;
+    case Protocol::Connected:       phase = tr("connected"); break;
+    case Protocol::ConnectFailed:   phase = tr("failed"); break;
+    default:                        return;
+    }
+    phase += QString(" %1s").arg(ms / 1000.0, 0, 'f', 2);
+    if (myProgressLabel->property("QNetCtlConnect").toUInt() != progress.id) {
+        myProgressLabel->setProperty("QNetCtlConnect", progress.id);
+        myProgressLabel->setText(profile + ": " + phase);
+    } else {
+        myProgressLabel->setText(myProgressLabel->text() + QString(" ") + QChar(0x2192) + ' ' + phase);
+    }
+    myProgressLabel->show();
+    if (progress.phase == Protocol::Connected || progress.phase == Protocol::ConnectFailed) {
+        myConnects.remove(progress.id);
+        myProgressTimer->start();
+    } else {
+        myProgressTimer->stop();
+    }
+}
+
 void QNetCtl::quitTool()
 {
-    emit request("quit", "");
+    post(Protocol::Quit);
+    flushRequests(); // we're going down, there's no next event loop cycle
+}
+
+quint32 QNetCtl::post(int command, const QString &target, const QString &data, const QByteArray &payload)
+{
+    Protocol::Request request;
+    request.id = ++myRequestId;
+    request.command = command;
+    request.target = target;
+    request.data = data;
+    request.payload = payload;
+    myRequests << request;
+    myRequestStarts.insert(request.id, Trace::now());
+    Trace::record(Trace::AsyncBegin, Protocol::name(command), request.id, target);
+    myRequestTimer->start(); // everything posted in this event cycle goes out as one batch
+    return request.id;
 }
 
-void QNetCtl::writeProfile(QTreeWidgetItem *item, QString key)
+void QNetCtl::flushRequests()
 {
-    QString name = item->data(0, ProfileRole).toString();
+    myRequestTimer->stop();
+    if (myRequests.isEmpty() || !iHaveHelper)
+        return; // nobody would hear them
+    emit batch(Protocol::Version, Protocol::pack(myRequests));
+    Trace::record(Trace::Instant, "batch sent", 0, QString::number(myRequests.count()) + " requests");
+    myRequests.clear();
+}
+
+void QNetCtl::writeProfile(const Connection &con, QString key)
+{
+    QString name = con.profile;
     if (name.isEmpty()) {
-        name = item->data(0, SsidRole).toString();
+        name = con.SSID;
         if (name.isEmpty()) {
-            name = item->data(0, InterfaceRole).toString();
+            name = con.interface;
         }
         name.prepend("qnetctl-");
     }
 
-    const int type = item->data(0, TypeRole).toInt();
+    const int type = con.type;
     const bool wireless = type > Connection::Ethernet;
-#define DATA(_S_) item->data(0, _S_##Role).toString() + '\n'
     QString profile =   "Description='Written by QNetCtl'\n"
                         "Connection=" + QString(wireless ? "wireless" : "ethernet") + '\n' +
-                        "Interface=" + DATA(Interface);
-    const QString ip = item->data(0, IPRole).toString();
+                        "Interface=" + con.interface + '\n';
+    const QString ip = con.ipResolution;
     if (ip == "dhcp") {
         profile += "IP=dhcp\n"; //‘static’, ‘dhcp’, or ‘no’
 //         "IP6" + + //‘static’, ‘stateless’, ‘dhcp-noaddr’, ‘dhcp’, ‘no’ or left out (empty)
@@ -794,18 +1189,62 @@ void QNetCtl::writeProfile(QTreeWidgetItem *item, QString key)
             sec = "wep";
         else
             sec = "none";
-        if (!item->data(0, AutoconnectRole).toBool()) {
+        if (!con.autoConnect) {
             profile += "ExcludeAuto=true\n";
         }
         profile +=  "Security=" + sec + '\n' +
-                    "ESSID=" + DATA(Ssid) +
-                    "AP=" + DATA(Mac) +// The BSSID (MAC address) of the access point to connect to.
-                    "Key=" + key + '\n' +
+                    "ESSID=" + con.SSID + '\n';
+        // no AP= unless the user pinned one: the SSID may be served by many BSSes, see roam()
+        if (!con.pinnedBSSID.isEmpty())
+            profile += "AP=" + con.pinnedBSSID + '\n'; // The BSSID (MAC address) of the access point to connect to.
+        profile +=  "Key=" + key + '\n' +
 //                     "Hidden=" + + // Whether or not the specified network is a hidden network. Defaults to ‘no’.
-                    "AdHoc=" + QString(item->data(0, AdHocRole).toBool() ? "yes\n" : "no\n");
+                    "AdHoc=" + QString(con.adHoc ? "yes\n" : "no\n");
+    }
+
+    post(Protocol::WriteProfile, name, profile);
+}
+
+void QNetCtl::countReply(const Protocol::Result &result)
+{
+    const QString command = Metrics::label("command", Protocol::name(result.command));
+    Metrics::counter("qnetctl_requests_total", "Requests answered by the helper", command).inc();
+    if (!result.ok)
+        Metrics::counter("qnetctl_requests_failed_total", "Requests the helper reported as failed", command).inc();
+    QHash<quint32, qint64>::iterator it = myRequestStarts.find(result.id);
+    if (it == myRequestStarts.end())
+        return;
+    const qint64 ms = (Trace::now() - *it) / 1000000;
+    myRequestStarts.erase(it);
+    Metrics::histogram("qnetctl_request_duration_seconds", "From queueing a request to its reply",
+                       gs_requestBuckets, 1000.0, command).observe(ms);
+    if (result.command == Protocol::ScanWifi && result.ok) {
+        Metrics::histogram("qnetctl_scan_duration_seconds", "Active scans, from the request to the results",
+                           gs_scanBuckets, 1000.0, Metrics::label("radio", result.target)).observe(ms);
     }
+}
+
+void QNetCtl::writeMetrics()
+{
+    if (!myMetricsPath.isEmpty() && !Metrics::write(myMetricsPath))
+        qDebug() << "cannot write the metrics to" << myMetricsPath;
+}
 
-    emit request("write_profile " + name, profile);
+void QNetCtl::exportTrace()
+{
+    if (iHaveHelper)
+        post(Protocol::DumpTrace); // the reply carries its events
+    else
+        writeTrace(QByteArray());
+}
+
+void QNetCtl::writeTrace(const QByteArray &helperEvents)
+{
+    const QString path = QDir::tempPath() + "/qnetctl-trace-" + QString::number(QCoreApplication::applicationPid()) + ".json";
+    if (Trace::write(path, QList<QByteArray>() << Trace::events() << helperEvents))
+        QMessageBox::information(this, tr("Trace written"), tr("Load %1 in chrome://tracing").arg(path));
+    else
+        QMessageBox::warning(this, tr("Trace not written"), tr("Cannot write %1").arg(path));
 }
 
 void QNetCtl::updateTree()
@@ -813,154 +1252,94 @@ void QNetCtl::updateTree()
     myUpdateTimer->start();
 }
 
-static void map(const Connection &con, QTreeWidgetItem *net)
+typedef QHash<QString, QList<int> > Index;
+
+static inline void addToIndex(Index &idx, const QString &key, int i)
 {
-    net->setData(0, IsDetailRole, false);
-    net->setData(0, TypeRole, con.type);
-    net->setData(0, QualityRole, con.quality);
-    net->setData(0, ConnectedRole, con.active);
-    net->setData(0, AdHocRole, con.adHoc);
-    net->setData(0, ProfileRole, con.profile);
-    net->setData(0, InterfaceRole, con.interface);
-    net->setData(0, IPRole, con.ipResolution);
-    net->setData(0, DescriptionRole, con.description);
-    net->setData(0, KeyRole, con.key);
-    net->setData(0, MacRole, con.MAC);
-    net->setData(0, SsidRole, con.SSID);
-    net->setData(0, KeyRole, con.key);
-    net->setData(0, AutoconnectRole, con.autoConnect);
-
-    QString title = con.profile;
-    if (title.isEmpty()) title = con.SSID;
-    if (title.isEmpty()) title = con.MAC;
-    if (title.isEmpty()) title = con.interface;
-    if (title.isEmpty()) title = "Nameless Network";
-    net->setData(0, Qt::DisplayRole, title);
+    if (!key.isEmpty())
+        idx[key] << i;
 }
 
-void QNetCtl::buildTree()
+// returns the first not yet taken entry for key and marks it taken
+static int take(Index &idx, const QString &key, QVector<bool> &taken)
 {
-    QList<Connection> temp = myProfiles;
-    foreach (const Connection &con, myWLANs) {
-        bool required = true;
-        for (QList<Connection>::iterator it = temp.begin(), end = temp.end(); it != end; ++it) {
-            if ((!con.SSID.isEmpty() && con.SSID == it->SSID) || it->MAC == con.MAC) {
-                required = false;
-                it->type = con.type;
-                it->quality = con.quality;
-                it->MAC = con.MAC;
-                it->adHoc = con.adHoc;
-                break;
-            }
-        }
-        if (required) {
-            temp << con;
-        }
-    }
-    for (QMap<QString, bool>::const_iterator it = myDevices.constBegin(),
-                                            end = myDevices.constEnd(); it != end; ++it) {
-        bool skip = false;
-        foreach (const Connection &con, temp) {
-            if (con.interface == it.key()) {
-                skip = true;
-                break;
-            }
-        }
-        if (skip)
-            break;
-        temp << Connection();
-        Connection &con = temp.last();
-        con.interface = it.key();
-        con.type = (*it) ? Connection::Wireless : Connection::Ethernet;
-    }
-
-    int n = myNetworks->invisibleRootItem()->childCount();
-    QList<QTreeWidgetItem*> toDelete;
-    for (int i = 0; i < n; ++i) {
-        QTreeWidgetItem *item = myNetworks->invisibleRootItem()->child(i);
-        char p = 0;
-        QString match = item->data(0, ProfileRole).toString();
-        if (match.isEmpty()) {
-            match = item->data(0, SsidRole).toString();
-            p = 1;
-        }
-        if (match.isEmpty()) {
-            match = item->data(0, InterfaceRole).toString();
-            p = 2;
-        }
-        if (match.isEmpty())
-            p = 3;
-
-        QList<Connection>::iterator it = temp.begin(), end = temp.end();
-        while (it != end) {
-            const bool matches = (p == 0 && match == it->profile) ||
-                                 (p == 1 && match == it->SSID) ||
-                                 (p == 2 && match == it->interface);
-            if (matches) {
-                map(*it, item);
-                temp.erase(it); // sic! do not assign it - we break out of the loop and raising it might turn it end
-                break;
-            }
-            ++it;
-        }
-        if (it == end/* && item->data(0, ProfileRole).toString().isEmpty()*/) {
-            // none found, the tree item is not in the available connections -> kick it
-            toDelete << item;
+    Index::iterator it = idx.find(key);
+    if (it == idx.end())
+        return -1;
+    while (!it->isEmpty()) {
+        const int i = it->takeFirst();
+        if (!taken.at(i)) {
+            taken[i] = true;
+            return i;
         }
     }
+    return -1;
+}
 
-    foreach (QTreeWidgetItem *item, toDelete) {
-        for (int i = item->childCount() -1; i > -1; --i) {
-            delete item->child(i);
-        }
-        delete item;
+void QNetCtl::buildTree()
+{
+    TRACE_SPAN("build tree");
+    const QList<Connection> temp = Networks::merge(myProfiles, scannedNetworks(), myDevices, myEnabledProfiles);
+    Metrics::gauge("qnetctl_networks", "Listed networks: profiles, access points and bare devices").set(temp.count());
+
+    // reconcile the existing rows, every connection can be taken by one row only
+    Index byProfile, bySsidToTake, byInterface;
+    for (int i = 0; i < temp.count(); ++i) {
+        addToIndex(byProfile, temp.at(i).profile, i);
+        addToIndex(bySsidToTake, temp.at(i).SSID, i);
+        addToIndex(byInterface, temp.at(i).interface, i);
     }
-
-    foreach (const Connection &con, temp) {
-        QTreeWidgetItem *net = new QTreeWidgetItem;
-        map(con, net);
-        QTreeWidgetItem *detail = new QTreeWidgetItem(*net);
-        detail->setData(0, IsDetailRole, true);
-        net->addChild(detail);
-        myNetworks->addTopLevelItem(net);
+    QVector<bool> taken(temp.count(), false);
+    QList<int> toDelete;
+    for (int i = 0; i < myModel->count(); ++i) {
+        const Connection &con = myModel->connection(i);
+        int match = -1;
+        if (!con.profile.isEmpty())
+            match = take(byProfile, con.profile, taken);
+        else if (!con.SSID.isEmpty())
+            match = take(bySsidToTake, con.SSID, taken);
+        else if (!con.interface.isEmpty())
+            match = take(byInterface, con.interface, taken);
+        if (match > -1)
+            myModel->setConnection(i, temp.at(match)); // emits dataChanged only if something changed
+        else // none found, the row is not in the available connections -> kick it
+            toDelete << i;
     }
+    myModel->remove(toDelete);
 
-    n = myNetworks->invisibleRootItem()->childCount(); // may have changed
-    for (int i = 0; i < n; ++i) {
-        QTreeWidgetItem *item = myNetworks->invisibleRootItem()->child(i);
-        const int type = item->data(0, TypeRole).toInt();
-        const QString interface = item->data(0, InterfaceRole).toString();
-        if (type > Connection::Ethernet && myEnabledProfiles.contains("netctl-auto@" + interface + ".service"))
-            continue; // controlled by profile attribute
-        const bool enabled = (type == Connection::Ethernet && myEnabledProfiles.contains("netctl-ifplugd@" + interface + ".service")) ||
-                             myEnabledProfiles.contains(item->data(0, ProfileRole).toString());
-        item->setData(0, AutoconnectRole, enabled);
+    QList<Connection> newConnections;
+    for (int i = 0; i < temp.count(); ++i) {
+        if (!taken.at(i))
+            newConnections << temp.at(i);
     }
+    myModel->append(newConnections);
 }
 
-void QNetCtl::showSelected(QTreeWidgetItem *item, QTreeWidgetItem *prev)
+void QNetCtl::showSelected(const QModelIndex &index, const QModelIndex &previous)
 {
-    if (item && item->isExpanded())
+    if (index.isValid() && myNetworks->isExpanded(index))
         return;
     updateConnectButton();
-    if (!item || !item->parent() || item->parent() == myNetworks->invisibleRootItem()) {
+    if (!index.parent().isValid()) {
         int delay = 0;
-        if (prev) {
-            if (!prev->isExpanded() && prev->parent() && prev->parent() != item)
-                prev = prev->parent();
-            if (prev->isExpanded()) {
+        QModelIndex prev = previous;
+        if (prev.isValid()) {
+            if (!myNetworks->isExpanded(prev) && prev.parent().isValid() && prev.parent() != index)
+                prev = prev.parent();
+            if (myNetworks->isExpanded(prev)) {
                 delay = 250;
-                myNetworks->collapseItem(prev);
+                myNetworks->collapse(prev);
             }
         }
-        myNetworks->setCurrentItem(item);
         QTimer::singleShot(delay, this, SLOT(expandCurrent()));
     }
 }
 
 void QNetCtl::expandCurrent()
 {
-    myNetworks->expandItem(currentItem());
+    const int row = currentRow();
+    if (row > -1)
+        myNetworks->expand(myModel->index(row, 0));
 }
 
 bool QNetCtl::updateAutoConnects()
@@ -973,13 +1352,12 @@ bool QNetCtl::updateAutoConnects()
     // if there is only one autoconnecting eth0 profile, we just enable it and disable everything else
     // if there're multiple autoconnecting eth0 profiles, that's for now (TODO: priority??) a conflict
     QStringList autoEth0, autoWifi;
-    const int n = myNetworks->invisibleRootItem()->childCount();
+    const int n = myModel->count();
     for (int i = 0; i < n; ++i) {
-        QTreeWidgetItem *item = myNetworks->invisibleRootItem()->child(i);
-        const int type = item->data(0, TypeRole).toInt();
-        const bool autoConnect = item->data(0, AutoconnectRole).toBool();
-        const QString interface = item->data(0, InterfaceRole).toString();
-        if (type > Connection::Ethernet) {
+        const Connection &con = myModel->connection(i);
+        const bool autoConnect = con.autoConnect;
+        const QString &interface = con.interface;
+        if (con.type > Connection::Ethernet) {
             if (autoConnect && !autoWifi.contains(interface))
                 autoWifi << interface;
         } else if (autoConnect) {
@@ -1057,9 +1435,8 @@ bool QNetCtl::updateAutoConnects()
         }
     } else { // simple eth0 setup
         for (int i = 0; i < n; ++i) {
-            QTreeWidgetItem *item = myNetworks->invisibleRootItem()->child(i);
-            if (item->data(0, AutoconnectRole).toBool()) {
-                const QString profile(item->data(0, ProfileRole).toString());
+            if (myModel->connection(i).autoConnect) {
+                const QString profile(myModel->connection(i).profile);
                 requiredProfiles << profile;
                 myEnabledProfiles.removeAll(profile);
             }
@@ -1069,22 +1446,23 @@ bool QNetCtl::updateAutoConnects()
     // disable remaining enabled ones
     foreach (const QString &profile, myEnabledProfiles) {
         // profiles ending with .service are illegal and meant for systemctl
-        emit request(profile.endsWith(".service") ? "disable_service" : "disable_profile", profile);
+        post(profile.endsWith(".service") ? Protocol::DisableService : Protocol::DisableProfile, profile);
     }
 
     myEnabledProfiles = requiredProfiles;
     // enable required
     foreach (const QString &profile, myEnabledProfiles) {
         // profiles ending with .service are illegal and meant for systemctl
-        emit request(profile.endsWith(".service") ? "enable_service" : "enable_profile", profile);
+        post(profile.endsWith(".service") ? Protocol::EnableService : Protocol::EnableProfile, profile);
     }
 
     return true;
 }
 
 void QNetCtl::updateConnectButton() {
-    if (QTreeWidgetItem *item = currentItem()) {
-        const bool active = item->data(0, ConnectedRole).toBool();
+    const int row = currentRow();
+    if (row > -1) {
+        const bool active = myModel->connection(row).active;
         myConnectButton->setEnabled(true);
         myConnectButton->setVisible(!active);
         myDisconnectButton->setVisible(active);
@@ -1108,21 +1486,32 @@ void QNetCtl::verifyPath()
 }
 
 static QNetCtl *gs_netCtl = 0;
+static int gs_signalPipe[2] = { -1, -1 };
 
+// only async-signal-safe calls in here - the helper quits on its own once our bus name is gone
 void signalHandler(int signal)
 {
-    if (!gs_netCtl)
+    if (signal == SIGSEGV || signal == SIGABRT) {
+        Log::crashDump(); // before anything else can go wrong
+        // returning would only re-run the faulting instruction
+        ::signal(signal, SIG_DFL);
+        raise(signal);
         return;
-    if (signal == SIGTERM || signal == SIGQUIT || signal == SIGINT) {
-        gs_netCtl->quitTool();
-        QApplication::quit();
-    } else if (signal == SIGSEGV || signal == SIGABRT) {
-        gs_netCtl->quitTool();
     }
+    // SIGTERM, SIGQUIT, SIGINT: the event loop picks it up
+    const int savedErrno = errno;
+    const char c = signal;
+    if (write(gs_signalPipe[1], &c, 1) < 0) {} // full: a quit is pending anyway
+    errno = savedErrno;
 }
 
 int main(int argc, char **argv)
 {
+    if (argc > 1 && !strcmp(argv[1], "--json")) {
+        QCoreApplication a(argc, argv);
+        return JsonCli::exec(a.arguments().mid(2));
+    }
+
     signal(SIGSEGV, signalHandler);
     signal(SIGTERM, signalHandler);
     signal(SIGQUIT, signalHandler);
@@ -1130,7 +1519,17 @@ int main(int argc, char **argv)
     signal(SIGABRT, signalHandler);
 
     QApplication a(argc, argv);
+    if (!pipe2(gs_signalPipe, O_CLOEXEC|O_NONBLOCK)) {
+        QSocketNotifier *quitter = new QSocketNotifier(gs_signalPipe[0], QSocketNotifier::Read, &a);
+        QObject::connect (quitter, SIGNAL(activated(int)), &a, SLOT(quit()));
+    }
+    const QString logDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(logDir);
+    Log::open(logDir + "/qnetctl.log", Log::levelFromEnv("QNETCTL_LOG_LEVEL", Log::Warning));
+    Log::captureQtMessages();
     gs_netCtl = new QNetCtl;
     gs_netCtl->show();
-    return a.exec();
+    const int ret = a.exec();
+    Log::close();
+    return ret;
 }
\ No newline at end of file
@@ -22,26 +22,28 @@
 #define Q_NET_CTL_H
 
 class ErrorLabel;
+class LinkMonitor;
+class NetworkModel;
+class Nl80211;
+class ProfileIndex;
+class ScanCache;
+class ScanScheduler;
+class SystemdUnits;
+class QLabel;
+class QModelIndex;
 class QPushButton;
 class QTimer;
-class QTreeWidget;
-class QTreeWidgetItem;
+class QTreeView;
+#include <QHash>
 #include <QList>
 #include <QMap>
+#include <QSet>
 #include <QTabWidget>
 
-class Connection
-{
-public:
-    enum Type { Unknown = 0, Ethernet, Wireless, WEP, WPA, WPA1, WPA2 };
-    Connection() : type(Unknown), quality(0), active(false), adHoc(false) {}
-    Connection(const Connection &other);
-    explicit Connection(QString profile);
-    Type type;
-    QString SSID, MAC, description, interface, profile, ipResolution, key;
-    int quality;
-    bool active, adHoc, autoConnect;
-};
+#include "Connection.h"
+#include "Protocol.h"
+#include "Roaming.h"
+#include "SignalHistory.h"
 
 namespace Ui {
     class Settings;
@@ -54,19 +56,46 @@ class QNetCtl : public QTabWidget
 public:
     QNetCtl();
 //     ~QNetCtl();
-    void reply(QString tag, QString information);
+    void batchReply(uint version, QByteArray results);
+    /// the helper listens, the queued requests can go out
+    void helperReady(uint version);
+    /// a phase of a running connect, shown and recorded per profile
+    void progress(uint version, QByteArray data);
     void quitTool();
 signals:
-    void request(QString tag, QString info);
+    void batch(uint version, QByteArray requests);
 protected:
     void closeEvent(QCloseEvent *event);
+    void hideEvent(QHideEvent *event);
+    void showEvent(QShowEvent *event);
 private:
+    void applyBss(const QString &device, const WifiBssList &bssList);
+    void applyScan(const QString &device, const QList<Connection> &scan);
+    void parseWifiScan(QString device, QByteArray networks);
+    /// queues a request for the helper, returns its id
+    quint32 post(int command, const QString &target = QString(), const QString &data = QString(),
+                 const QByteArray &payload = QByteArray());
+    void scanResults(QString device, QByteArray bss);
     void checkConnections();
-    QTreeWidgetItem *currentItem() const;
+    void countReply(const Protocol::Result &result);
+    int currentRow() const;
     void query(QString cmd, const char *slot);
+    /// an active scan on device was requested and did not time out yet
+    bool isScanning(const QString &device) const;
     void readConfig();
+    /// asks the helper to move the active profile on device to a better BSS, if there is one
+    void roam(const QString &device);
+    /// renders the last session and the synchronously available data, before anything was forked
+    void restoreSnapshot();
+    void saveSnapshot() const;
+    /// all scan caches, merged by BSSID
+    QList<Connection> scannedNetworks() const;
+    /// the configured TTL in ms, but at least two scan intervals - a backed off scheduler must not age out the APs
+    int scanTTL() const;
+    Protocol::ScanTarget scanTarget(const QString &device);
     void updateTree();
-    void writeProfile(QTreeWidgetItem *item, QString key);
+    void writeTrace(const QByteArray &helperEvents);
+    void writeProfile(const Connection &con, QString key);
 private slots:
     void buildTree();
     void checkDevices();
@@ -74,27 +103,55 @@ private slots:
     void disconnectNetwork();
     bool editProfile();
     void expandCurrent();
+    /// asks the helper for its events and writes both traces to one file
+    void exportTrace();
+    void flushRequests();
     void forgetProfile();
     void readProfiles();
+    /// passive, reads what the kernel has cached from the last scan
+    void refreshWifi(QString device);
     void scanWifi();
-    void parseDevices();
-    void parseEnabledNetworks();
+    void setScanTTL(int seconds);
+    void parseEnabledNetworks(QStringList units);
     void parseProfiles();
-    void parseWifiDevs();
-    void parseWifiScan(QString networks);
-    void showSelected(QTreeWidgetItem *, QTreeWidgetItem*);
+    void removeLink(QString interface);
+    void showSelected(const QModelIndex &index, const QModelIndex &previous);
     bool updateAutoConnects();
     void updateConnectButton();
+    void updateLink(QString interface, bool up, bool carrier, bool wireless);
+    void updateProfiles();
     void verifyPath();
+    void writeMetrics();
 private:
-    QTreeWidget *myNetworks;
+    QTreeView *myNetworks;
+    NetworkModel *myModel;
     ErrorLabel *myErrorLabel;
+    QLabel *myProgressLabel;
     QPushButton *myConnectButton, *myDisconnectButton, *myForgetButton, *myEditButton;
-    QList<Connection> myProfiles, myWLANs;
+    QList<Connection> myProfiles;
+    ProfileIndex *myProfileIndex;
+    QMap<QString, ScanCache*> myScanCaches; // per radio, a slow chip mustn't hold back the others
+    QHash<QString, qint64> myScanningDevices; // Trace::now() when the active scan was requested
+    QMap<QString, QSet<quint32> > myScanCoverage; // frequencies of the last active scan per radio
+    QMap<QString, int> myTargetedScans;
+    QHash<QString, QSet<quint32> > myKnownFrequencies; // per SSID of the saved networks
+    SignalHistory mySignalHistory; // per BSSID, across the radios
+    Roaming myRoaming;
+    Nl80211 *myNl80211;
+    int myScanRound;
     QStringList myEnabledProfiles;
+    SystemdUnits *mySystemdUnits;
     QMap<QString, bool> myDevices;
-    QTimer *myUpdateTimer, *myRescanTimer, *myAutoConnectUpdateTimer;
-    int iWaitForIwScan;
+    LinkMonitor *myLinkMonitor;
+    QTimer *myUpdateTimer, *myAutoConnectUpdateTimer, *myRequestTimer, *myProgressTimer;
+    ScanScheduler *myScanScheduler;
+    QSet<QString> myCarriers;
+    Protocol::RequestList myRequests;
+    quint32 myRequestId;
+    QHash<quint32, qint64> myRequestStarts; // Trace::now() of the pending requests
+    QHash<quint32, QString> myConnects; // SwitchToProfile request -> profile
+    QString myMetricsPath;
+    bool iHaveHelper;
     Ui::Settings *mySettings;
     Ui::IPConfig *myProfileConfig;
 };
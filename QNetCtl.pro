@@ -1,7 +1,9 @@
-HEADERS     = QNetCtl.h QNetCtl_dbus.h
-SOURCES     = QNetCtl.cpp
+HEADERS     = QNetCtl.h QNetCtl_dbus.h JsonCli.h
+SOURCES     = QNetCtl.cpp JsonCli.cpp
 FORMS       = ipconfig.ui settings.ui
 QT          += dbus widgets
+LIBS        += -L$$OUT_PWD -lqnetctlcore
+PRE_TARGETDEPS += $$OUT_PWD/libqnetctlcore.a
 TARGET      = qnetctl
 VERSION     = 0.1
 target.path += /usr/bin
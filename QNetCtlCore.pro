@@ -0,0 +1,6 @@
+TEMPLATE    = lib
+CONFIG      += staticlib
+HEADERS     = Connection.h LinkMonitor.h Log.h Metrics.h Netlink.h NetworkModel.h Networks.h Nl80211.h ProfileIndex.h Protocol.h Roaming.h ScanCache.h ScanScheduler.h SignalHistory.h Snapshot.h SystemdUnits.h Trace.h WifiBss.h
+SOURCES     = Connection.cpp LinkMonitor.cpp Log.cpp Metrics.cpp Netlink.cpp NetworkModel.cpp Networks.cpp Nl80211.cpp ProfileIndex.cpp Roaming.cpp ScanCache.cpp ScanScheduler.cpp SignalHistory.cpp Snapshot.cpp SystemdUnits.cpp Trace.cpp
+QT          = core dbus
+TARGET      = qnetctlcore
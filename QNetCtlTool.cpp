@@ -1,27 +1,33 @@
 
 #include "QNetCtlTool.h"
+#include "Connection.h"
+#include "LinkMonitor.h"
+#include "Log.h"
+#include "Nl80211.h"
+#include "Trace.h"
 
 #include <QDBusConnection>
 #include <QDBusInterface>
+#include <QDBusMessage>
+#include <QDBusServiceWatcher>
 #include <QFile>
 #include <QProcess>
 #include <QProcessEnvironment>
+#include <QRegExp>
 #include <QTimer>
+#include <QVariant>
 
+#include <net/if.h>
+#include <signal.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "paths.h"
 
-static void debug(QString s) {
-    QFile file("/tmp/qnetctl.dbg");
-    file.open(QIODevice::Append);
-    file.write(s.append("\n").toLocal8Bit());
-}
-
-QNetCtlTool::QNetCtlTool(int &argc, char **argv) : QCoreApplication(argc, argv)
+QNetCtlTool::QNetCtlTool(int &argc, char **argv) : QCoreApplication(argc, argv), myBatchId(0)
 {
     if (argc < 4) {
-        qWarning("Must pass clients DBus address, name and service!");
+        LOG(Error, "Must pass clients DBus address, name and service!");
         QMetaObject::invokeMethod(this, "quit", Qt::QueuedConnection);
         return;
     }
@@ -30,153 +36,311 @@ QNetCtlTool::QNetCtlTool(int &argc, char **argv) : QCoreApplication(argc, argv)
     seteuid(0);
 
     myClient = new QDBusInterface(argv[3], "/QNetCtl", "org.archlinux.qnetctl", bus, this);
-    bus.connect(argv[3], "/QNetCtl", "org.archlinux.qnetctl", "request", this, SLOT(request(QString, QString)));
+    bus.connect(argv[3], "/QNetCtl", "org.archlinux.qnetctl", "batch", this, SLOT(batch(uint, QByteArray)));
+    // the client may crash or get killed w/o sending Quit, its name vanishes either way
+    QDBusServiceWatcher *watcher = new QDBusServiceWatcher(argv[3], bus, QDBusServiceWatcher::WatchForUnregistration, this);
+    connect (watcher, SIGNAL(serviceUnregistered(QString)), SLOT(quit()));
+
+    myLinkMonitor = new LinkMonitor(this);
+    connect (myLinkMonitor, SIGNAL(linkChanged(QString, bool, bool, bool)), SLOT(linkChanged(QString, bool, bool)));
+    // only we follow the connects, the GUI doesn't subscribe to addresses and MLME events
+    myLinkMonitor->watchAddresses();
+    connect (myLinkMonitor, SIGNAL(addressAdded(QString, QString)), SLOT(addressAdded(QString, QString)));
+    connect (myLinkMonitor, SIGNAL(setUpFailed(QString, bool, int)), SLOT(linkSetUpFailed(QString, bool, int)));
+
+    myNl80211 = new Nl80211(this);
+    connect (myNl80211, SIGNAL(scanFinished(QString)), SLOT(scanFinished(QString)));
+    connect (myNl80211, SIGNAL(scanFailed(QString)), SLOT(scanFailed(QString)));
+    myNl80211->watchMlme();
+    connect (myNl80211, SIGNAL(mlmeEvent(QString, int, QString)), SLOT(mlmeEvent(QString, int, QString)));
+
+    // the client holds its requests back until we listen - and if it's already gone, so are we
+    const QDBusMessage reply = myClient->call("helperReady", uint(Protocol::Version));
+    if (reply.type() == QDBusMessage::ErrorMessage) {
+        LOG(Error, "client did not answer: %s", qPrintable(reply.errorMessage()));
+        QMetaObject::invokeMethod(this, "quit", Qt::QueuedConnection);
+    }
 }
 
+void QNetCtlTool::processFinished()
+{
+    QProcess *proc = static_cast<QProcess*>(sender());
+    const int batch = proc->property("QNetCtlBatch").toInt();
+    const bool ok = proc->exitStatus() == QProcess::NormalExit && !proc->exitCode();
+    const QString message = ok ? QString::fromLocal8Bit(proc->readAllStandardOutput())
+                               : QString("ERROR: %1, %2").arg(proc->exitStatus()).arg(proc->exitCode());
+    const qint64 started = proc->property("QNetCtlStarted").toLongLong(), exited = Trace::now();
+    if (ok)
+        LOG(Info, "%s %s: done after %lld ms", qPrintable(proc->program()), qPrintable(proc->arguments().join(" ")),
+                  (exited - started) / 1000000);
+    else
+        LOG(Warning, "%s %s: failed, status %d, exit code %d", qPrintable(proc->program()),
+                     qPrintable(proc->arguments().join(" ")), int(proc->exitStatus()), proc->exitCode());
+    foreach (const QVariant &v, proc->property("QNetCtlIndices").toList()) {
+        const int index = v.toInt();
+        if (myBatches.contains(batch)) {
+            const Protocol::Result &result = myBatches[batch].results.at(index);
+            Trace::record(Trace::Complete, Protocol::name(result.command), result.id,
+                          proc->program() + ' ' + proc->arguments().join(" "), started, exited - started);
+            if (ok && result.command == Protocol::RemoveProfile) // disabled, now it can go
+                QFile::remove(gs_profilePath + result.target);
+            else if (result.command == Protocol::SwitchToProfile)
+                finishConnect(result.id, ok, message);
+        }
+        complete(batch, index, ok, message);
+    }
+}
 
-void QNetCtlTool::chain()
+void QNetCtlTool::processError(QProcess::ProcessError error)
 {
+    if (error != QProcess::FailedToStart)
+        return; // finished() follows
+    // and finished() does not, eg. a missing wpa_cli - answer now or the client waits forever
     QProcess *proc = static_cast<QProcess*>(sender());
-    const QString tag = proc->property("QNetCtlTag").toString();
-    const QString info = proc->property("QNetCtlInfo").toString();
-    if (proc->exitStatus() != QProcess::NormalExit || proc->exitCode()) {
-        myClient->call(QDBus::NoBlock, "reply", tag, QString("ERROR: %1, %2").arg(proc->exitStatus()).arg(proc->exitCode()));
+    const QString message = QString("ERROR: failed to start %1: %2").arg(proc->program()).arg(proc->errorString());
+    LOG(Warning, "%s", qPrintable(message));
+    proc->deleteLater();
+    const QVariant device = proc->property("QNetCtlScanDevice");
+    if (device.isValid()) {
+        if (myScans.value(device.toString()).state == Scan::Scanning)
+            finishScan(device.toString(), false, message);
         return;
     }
-    myClient->call(QDBus::NoBlock, "reply", tag, QString::fromLocal8Bit(proc->readAllStandardOutput()));
-
-    QString cmd;
-    if (tag == "remove_profile") {
-        QFile::remove(gs_profilePath + info);
-    } else if (tag == "scan_wifi") {
-        myScanningDevices.removeAll(info);
-        myUplinkingDevices.removeAll(info);
-        cmd = TOOL(ip) + " link set " + info + " down";
+    const int batch = proc->property("QNetCtlBatch").toInt();
+    foreach (const QVariant &v, proc->property("QNetCtlIndices").toList()) {
+        const int index = v.toInt();
+        if (myBatches.contains(batch) && myBatches[batch].results.at(index).command == Protocol::SwitchToProfile)
+            finishConnect(myBatches[batch].results.at(index).id, false, message);
+        complete(batch, index, false, message);
     }
+}
 
-    if (cmd.isNull()) // should not happen
+void QNetCtlTool::processStarted()
+{
+    QProcess *proc = static_cast<QProcess*>(sender());
+    const int batch = proc->property("QNetCtlBatch").toInt();
+    const qint64 spawned = proc->property("QNetCtlSpawned").toLongLong(), started = Trace::now();
+    proc->setProperty("QNetCtlStarted", started);
+    if (!myBatches.contains(batch))
         return;
+    foreach (const QVariant &v, proc->property("QNetCtlIndices").toList())
+        Trace::record(Trace::Complete, "spawn", myBatches[batch].results.at(v.toInt()).id,
+                      proc->program(), spawned, started - spawned);
+}
 
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-    env.remove("LC_ALL");
-    env.remove("LANG");
-    proc = new QProcess(this);
-    proc->setProcessEnvironment(env);
-//     proc->setProperty("QNetCtlTag", tag);
-//     connect (proc, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(reply()));
-    connect (proc, SIGNAL(finished(int, QProcess::ExitStatus)), proc, SLOT(deleteLater()));
-    proc->start(cmd, QIODevice::ReadOnly);
+void QNetCtlTool::complete(int batch, int index, bool ok, const QString &message, qint32 payloadType, const QByteArray &payload)
+{
+    QMap<int, Batch>::iterator it = myBatches.find(batch);
+    if (it == myBatches.end())
+        return;
+    Protocol::Result &result = it->results[index];
+    result.ok = ok;
+    result.message = message;
+    result.payloadType = payloadType;
+    result.payload = payload;
+    it->ready << index;
+    if (!it->dispatching) // a scan must not wait for a slow "netctl switch-to" in the same batch
+        release(batch);
 }
 
-void QNetCtlTool::scanWifi(QString device)
+void QNetCtlTool::completeScan(const QString &device, bool ok, const QString &message, qint32 payloadType, const QByteArray &payload)
 {
-    if (device.isNull() && sender())
-        device = sender()->property("QNetCtlScanDevice").toString();
+    const QList<QPair<int, int> > requests = myScanRequests.values(device);
+    myScanRequests.remove(device);
+    for (int i = 0; i < requests.count(); ++i)
+        complete(requests.at(i).first, requests.at(i).second, ok, message, payloadType, payload);
+}
 
-    if (myScanningDevices.contains(device))
+void QNetCtlTool::release(int batch)
+{
+    QMap<int, Batch>::iterator it = myBatches.find(batch);
+    if (it == myBatches.end())
         return;
+    if (!it->ready.isEmpty()) {
+        Protocol::ResultList results;
+        foreach (int index, it->ready)
+            results << it->results.at(index);
+        myClient->call(QDBus::NoBlock, "batchReply", uint(Protocol::Version), Protocol::pack(results));
+        foreach (const Protocol::Result &result, results)
+            Trace::record(Trace::Instant, "reply sent", result.id);
+        it->pending -= it->ready.count();
+        it->ready.clear();
+    }
+    if (!it->pending && !it->dispatching)
+        myBatches.erase(it);
+}
 
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-    env.remove("LC_ALL");
-    env.remove("LANG");
-    QProcess *proc = new QProcess(this);
-    proc->setProcessEnvironment(env);
+void QNetCtlTool::scanWifi(const QString &device, const Protocol::ScanTarget &target)
+{
+    Scan &scan = myScans[device];
+    if (scan.state != Scan::Idle)
+        return; // the running scan answers this request as well, even if it's targeted differently
+    scan.target = target;
+    scan.since = Trace::now();
 
-    bool isDown = false;
-    proc->start(TOOL(ip) + " link show " + device, QIODevice::ReadOnly);
-    proc->waitForFinished();
-    if (proc->exitStatus() == QProcess::NormalExit && !proc->exitCode())
-        isDown = !QString::fromLocal8Bit(proc->readAllStandardOutput()).section('>', 0, 0).contains("UP");
+    const int flags = myLinkMonitor->flags(device);
+    if (flags < 0) {
+        finishScan(device, false, QString("ERROR: no link %1 (%2)").arg(device).arg(flags));
+        return;
+    }
+    if (flags & IFF_UP) {
+        startScan(device);
+        return;
+    }
+    if (!myLinkMonitor->setUp(device, true)) {
+        finishScan(device, false, "ERROR: cannot set " + device + " up");
+        return;
+    }
+    // linkChanged() starts the scan as soon as the kernel reports the link up
+    scan.broughtUp = true;
+    scan.state = Scan::WaitingForUp;
+    if (!scan.timer) {
+        scan.timer = new QTimer(this);
+        scan.timer->setSingleShot(true);
+        scan.timer->setInterval(10000); // from the request, firmware loading can take a while
+        scan.timer->setProperty("QNetCtlScanDevice", device);
+        connect (scan.timer, SIGNAL(timeout()), SLOT(linkTimeout()));
+    }
+    scan.timer->start();
+}
+
+static inline int bit(int phase)
+{
+    return 1 << phase;
+}
 
-    bool waitsForUp = myUplinkingDevices.contains(device);
+void QNetCtlTool::watchConnect(quint32 id, const QString &profile)
+{
+    if (profile.contains('/'))
+        return;
+    const QString device = Connection(profile).interface;
+    if (device.isEmpty())
+        return;
+    Attempt &attempt = myAttempts[device]; // a later switch-to on the device takes over
+    attempt.id = id;
+    attempt.phases = 0;
+    // what's already there at the start belongs to the previous connection, netctl takes that down first
+    const int flags = myLinkMonitor->flags(device);
+    if (flags > 0 && (flags & IFF_UP))
+        attempt.phases |= bit(Protocol::LinkUp);
+    if (flags > 0 && (flags & IFF_RUNNING))
+        attempt.phases |= bit(Protocol::Carrier) | bit(Protocol::AddressAssigned);
+}
 
-    if (isDown) {
-        if (!waitsForUp) {
-            waitsForUp = true;
-            myUplinkingDevices << device;
-            proc->start(TOOL(ip) + " link set " + device + " up", QIODevice::ReadOnly);
-            proc->waitForFinished();
-        }
+void QNetCtlTool::progress(const QString &device, int phase, const QString &detail)
+{
+    QMap<QString, Attempt>::iterator it = myAttempts.find(device);
+    if (it == myAttempts.end() || (it->phases & bit(phase)))
+        return;
+    it->phases |= bit(phase);
+    Protocol::Progress p;
+    p.id = it->id;
+    p.phase = phase;
+    p.time = Trace::now();
+    p.device = device;
+    p.detail = detail;
+    Trace::record(Trace::Instant, Protocol::phaseName(phase), p.id, detail.isEmpty() ? device : device + ' ' + detail);
+    LOG(Debug, "%s: %s %s", qPrintable(device), Protocol::phaseName(phase), qPrintable(detail));
+    myClient->call(QDBus::NoBlock, "progress", uint(Protocol::Version), Protocol::pack(p));
+}
 
-        // we're waiting for the device to come up
-        delete proc;
-        QTimer *t = new QTimer(this);
-        t->setProperty("QNetCtlScanDevice", device);
-        t->setSingleShot(true);
-        connect(t, SIGNAL(timeout()), this, SLOT(scanWifi()));
-        connect(t, SIGNAL(timeout()), t, SLOT(deleteLater()));
-        t->start(500);
+void QNetCtlTool::finishConnect(quint32 id, bool ok, const QString &message)
+{
+    for (QMap<QString, Attempt>::iterator it = myAttempts.begin(), end = myAttempts.end(); it != end; ++it) {
+        if (it->id != id)
+            continue;
+        progress(it.key(), ok ? Protocol::Connected : Protocol::ConnectFailed, ok ? QString() : message);
+        myAttempts.erase(it);
         return;
     }
+}
 
-    myScanningDevices << device;
+void QNetCtlTool::mlmeEvent(QString device, int event, QString bssid)
+{
+    if (!myAttempts.contains(device))
+        return;
+    switch (event) {
+    case Nl80211::Authenticated:
+        progress(device, Protocol::Authenticated, bssid);
+        break;
+    case Nl80211::Associated:
+    case Nl80211::Connected: // drivers w/ their own SME only report the result
+        progress(device, Protocol::Associated, bssid);
+        break;
+    case Nl80211::Disconnected:
+        myAttempts[device].phases &= ~(bit(Protocol::Authenticated) | bit(Protocol::Associated));
+        break;
+    default:
+        break;
+    }
+}
 
-    proc->setProperty("QNetCtlTag", "scan_wifi");
-    proc->setProperty("QNetCtlInfo", device);
-    // if we set it up, we've to set it back down through the chain slot
-    connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)), waitsForUp ? SLOT(chain()) : SLOT(reply()));
-    connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)), proc, SLOT(deleteLater()));
-    proc->start(TOOL(iw) + " dev " + device + " scan");
+void QNetCtlTool::addressAdded(QString device, QString address)
+{
+    if (myAttempts.value(device).phases & bit(Protocol::Carrier))
+        progress(device, Protocol::AddressAssigned, address);
 }
 
-void QNetCtlTool::reply()
+void QNetCtlTool::linkChanged(QString device, bool up, bool carrier)
 {
-    QProcess *proc = static_cast<QProcess*>(sender());
-    const QString tag = proc->property("QNetCtlTag").toString();
-    if (proc->exitStatus() != QProcess::NormalExit || proc->exitCode()) {
-        myClient->call(QDBus::NoBlock, "reply", tag, QString("ERROR: %1, %2").arg(proc->exitStatus()).arg(proc->exitCode()));
-        return;
-    }
-    myClient->call(QDBus::NoBlock, "reply", tag, QString::fromLocal8Bit(proc->readAllStandardOutput()));
-}
-
-void QNetCtlTool::request(const QString tag, const QString information)
-{
-    QString cmd;
-    bool chain = false;
-//     debug(tag + information);
-    if (tag == "switch_to_profile") {
-        cmd = TOOL(netctl) + " switch-to " + information;
-    } else if (tag == "stop_profile") {
-        cmd = TOOL(netctl) + " stop " + information;
-    } else if (tag == "scan_wifi") {
-        scanWifi(information);
-        return;
-    } else if (tag == "enable_profile") {
-        cmd = TOOL(netctl) + " enable " + information;
-    } else if (tag == "enable_service") {
-        if (information.startsWith("netctl-"))
-            cmd = TOOL(systemctl) + " enable " + information;
-    }
-    else if (tag == "disable_profile") {
-        cmd = TOOL(netctl) + " disable " + information;
-    } else if (tag == "disable_service") {
-        if (information.startsWith("netctl-"))
-            cmd = TOOL(systemctl) + " disable " + information;
-    } else if (tag == "remove_profile") {
-        chain = true;
-        cmd = TOOL(netctl) + " disable " + information;
-    } else if (tag.startsWith("write_profile")) {
-        QString name = tag.section(' ', 1);
-        QFile file(gs_profilePath + name);
-        if (file.open(QIODevice::WriteOnly|QIODevice::Text)) {
-            file.write(information.toLocal8Bit());
-            file.close();
-            myClient->call(QDBus::NoBlock, "reply", tag, "SUCCESS");
-        } else {
-            myClient->call(QDBus::NoBlock, "reply", tag, "ERROR");
-        }
-        return; // no process to run
-    } else if (tag == "reparse_config") {
+    if (myAttempts.contains(device)) {
+        int &phases = myAttempts[device].phases;
+        if (!up)
+            phases &= ~bit(Protocol::LinkUp);
+        if (!carrier)
+            phases &= ~(bit(Protocol::Carrier) | bit(Protocol::AddressAssigned));
+        if (up)
+            progress(device, Protocol::LinkUp);
+        if (carrier)
+            progress(device, Protocol::Carrier);
+    }
+    if (!up || myScans.value(device).state != Scan::WaitingForUp)
         return;
-    } else if (tag == "quit") {
-        quit();
+    myScans[device].timer->stop();
+    startScan(device);
+}
+
+void QNetCtlTool::linkSetUpFailed(QString device, bool up, int error)
+{
+    LOG(Warning, "cannot set %s %s: %s", qPrintable(device), up ? "up" : "down", strerror(-error));
+    if (!up || myScans.value(device).state != Scan::WaitingForUp)
         return;
-    }
+    myScans[device].broughtUp = false; // it's not
+    finishScan(device, false, QString("ERROR: cannot set %1 up (%2)").arg(device).arg(error));
+}
 
-    if (cmd.isNull()) {
-        myClient->call(QDBus::NoBlock, "reply", tag, "ERROR: unsupported command / request:" + information);
+void QNetCtlTool::linkTimeout()
+{
+    const QString device = sender()->property("QNetCtlScanDevice").toString();
+    if (myScans.value(device).state != Scan::WaitingForUp)
         return;
+    // the notification could have been lost to a socket overflow
+    const int flags = myLinkMonitor->flags(device);
+    if (flags > 0 && (flags & IFF_UP))
+        startScan(device);
+    else {
+        LOG(Warning, "%s did not come up within %d ms", qPrintable(device), myScans.value(device).timer->interval());
+        finishScan(device, false, "ERROR: " + device + " did not come up");
+    }
+}
+
+void QNetCtlTool::startScan(const QString &device)
+{
+    Scan &scan = myScans[device];
+    if (scan.state == Scan::WaitingForUp) {
+        const qint64 up = Trace::now();
+        Trace::record(Trace::Complete, "link up", 0, device, scan.since, up - scan.since);
+        scan.since = up;
+    }
+    scan.state = Scan::Scanning;
+    LOG(Debug, "scanning %s, %d frequencies, %d ssids", qPrintable(device),
+               scan.target.frequencies.count(), scan.target.ssids.count());
+
+    const Protocol::ScanTarget &target = myScans[device].target;
+    if (myNl80211->isValid()) {
+        if (int error = myNl80211->triggerScan(device, target.frequencies, target.ssids))
+            finishScan(device, false, QString("ERROR: nl80211 %1 on %2").arg(error).arg(device));
+        return; // scanFinished() or scanFailed() will follow
     }
 
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
@@ -184,19 +348,207 @@ void QNetCtlTool::request(const QString tag, const QString information)
     env.remove("LANG");
     QProcess *proc = new QProcess(this);
     proc->setProcessEnvironment(env);
-    proc->setProperty("QNetCtlTag", tag);
-    if (chain) {
-        proc->setProperty("QNetCtlInfo", information);
-        connect (proc, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(chain()));
-    } else {
-        connect (proc, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(reply()));
+    proc->setProperty("QNetCtlScanDevice", device);
+    connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(dumpScan()));
+    connect(proc, SIGNAL(errorOccurred(QProcess::ProcessError)), SLOT(processError(QProcess::ProcessError)));
+    connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)), proc, SLOT(deleteLater()));
+    QStringList args;
+    args << "dev" << device << "scan";
+    if (!target.frequencies.isEmpty()) {
+        args << "freq";
+        foreach (quint32 frequency, target.frequencies)
+            args << QString::number(frequency);
     }
+    if (!target.ssids.isEmpty()) {
+        args << "ssid";
+        foreach (const QByteArray &ssid, target.ssids)
+            args << QString::fromUtf8(ssid);
+    }
+    proc->start(TOOL(iw), args);
+}
+
+void QNetCtlTool::finishScan(const QString &device, bool ok, const QString &message, qint32 payloadType, const QByteArray &payload)
+{
+    Scan &scan = myScans[device];
+    if (!ok)
+        LOG(Warning, "scan on %s failed: %s", qPrintable(device), qPrintable(message));
+    if (scan.state != Scan::Idle)
+        Trace::record(Trace::Complete, scan.state == Scan::Scanning ? "scan" : "link up", 0, device,
+                      scan.since, Trace::now() - scan.since);
+    completeScan(device, ok, message, payloadType, payload);
+    if (scan.timer)
+        scan.timer->stop();
+    if (scan.broughtUp) { // if we set it up, we've to set it back down
+        scan.broughtUp = false;
+        myLinkMonitor->setUp(device, false);
+    }
+    scan.state = Scan::Idle;
+}
+
+void QNetCtlTool::dumpScan()
+{
+    QProcess *proc = static_cast<QProcess*>(sender());
+    const QString device = proc->property("QNetCtlScanDevice").toString();
+    if (proc->exitStatus() != QProcess::NormalExit || proc->exitCode())
+        finishScan(device, false, QString("ERROR: %1, %2").arg(proc->exitStatus()).arg(proc->exitCode()));
+    else // raw, the GUI parses the bytes w/o converting the entire dump
+        finishScan(device, true, QString(), Protocol::IwScanDump, proc->readAllStandardOutput());
+}
+
+void QNetCtlTool::scanFinished(QString device)
+{
+    if (myScans.value(device).state != Scan::Scanning)
+        return;
+    finishScan(device, true, QString(), Protocol::BssList, Protocol::pack(myNl80211->scanResults(device)));
+}
+
+void QNetCtlTool::scanFailed(QString device)
+{
+    if (myScans.value(device).state != Scan::Scanning)
+        return;
+    finishScan(device, false, "ERROR: scan aborted on " + device);
+}
+
+void QNetCtlTool::run(const QString &cmd, int batch, const QList<int> &indices)
+{
+    QVariantList list;
+    foreach (int index, indices)
+        list << index;
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.remove("LC_ALL");
+    env.remove("LANG");
+    QProcess *proc = new QProcess(this);
+    proc->setProcessEnvironment(env);
+    proc->setProperty("QNetCtlBatch", batch);
+    proc->setProperty("QNetCtlIndices", list);
+    connect (proc, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(processFinished()));
+    connect (proc, SIGNAL(started()), SLOT(processStarted()));
+    connect (proc, SIGNAL(errorOccurred(QProcess::ProcessError)), SLOT(processError(QProcess::ProcessError)));
     connect (proc, SIGNAL(finished(int, QProcess::ExitStatus)), proc, SLOT(deleteLater()));
-//     debug(cmd);
+    proc->setProperty("QNetCtlSpawned", Trace::now());
+    LOG(Info, "running %s", qPrintable(cmd));
     proc->start(cmd, QIODevice::ReadOnly);
 }
 
+void QNetCtlTool::batch(uint version, QByteArray requests)
+{
+    if (version != Protocol::Version) {
+        LOG(Error, "client speaks protocol version %u, we speak %d", version, int(Protocol::Version));
+        myClient->call(QDBus::NoBlock, "batchReply", uint(Protocol::Version), QByteArray());
+        return;
+    }
+
+    TRACE_SPAN("dispatch batch");
+    const Protocol::RequestList list = Protocol::unpack<Protocol::RequestList>(requests);
+    const int id = ++myBatchId;
+    LOG(Debug, "batch %d: %d requests", id, list.count());
+    Batch &entry = myBatches[id];
+    entry.pending = list.count(); // what completes while dispatching is replied at once
+    foreach (const Protocol::Request &request, list) {
+        Protocol::Result result;
+        result.id = request.id;
+        result.command = request.command;
+        result.target = request.target;
+        entry.results << result;
+    }
+
+    // systemctl takes any number of units, so the services are enabled and disabled at once
+    QStringList enableServices, disableServices;
+    QList<int> enableIndices, disableIndices;
+    bool quitAfterwards = false;
+    for (int i = 0; i < list.count(); ++i) {
+        const Protocol::Request &request = list.at(i);
+        const QString &target = request.target;
+        QString cmd;
+        Trace::record(Trace::Instant, "received", request.id, target);
+        switch (request.command) {
+        case Protocol::SwitchToProfile:
+            cmd = TOOL(netctl) + " switch-to " + target;
+            watchConnect(request.id, target);
+            break;
+        case Protocol::StopProfile:
+            cmd = TOOL(netctl) + " stop " + target;
+            break;
+        case Protocol::EnableProfile:
+            cmd = TOOL(netctl) + " enable " + target;
+            break;
+        case Protocol::DisableProfile:
+        case Protocol::RemoveProfile: // disabled first, removed by processFinished()
+            cmd = TOOL(netctl) + " disable " + target;
+            break;
+        case Protocol::EnableService:
+        case Protocol::DisableService:
+            if (!target.startsWith("netctl-"))
+                break;
+            if (request.command == Protocol::EnableService) {
+                enableServices << target;
+                enableIndices << i;
+            } else {
+                disableServices << target;
+                disableIndices << i;
+            }
+            continue;
+        case Protocol::WriteProfile: {
+            QFile file(gs_profilePath + target);
+            if (file.open(QIODevice::WriteOnly|QIODevice::Text)) {
+                file.write(request.data.toLocal8Bit());
+                file.close();
+                complete(id, i, true, "SUCCESS");
+            } else {
+                complete(id, i, false, "ERROR: " + file.errorString());
+            }
+            continue; // no process to run
+        }
+        case Protocol::ScanWifi:
+            myScanRequests.insert(target, qMakePair(id, i));
+            scanWifi(target, Protocol::unpack<Protocol::ScanTarget>(request.payload));
+            continue;
+        case Protocol::Roam: // netctl runs wpa_supplicant with its control socket in /run/wpa_supplicant
+            if (QRegExp("[0-9a-f]{2}(:[0-9a-f]{2}){5}").exactMatch(request.data) &&
+                if_nametoindex(target.toLocal8Bit().constData()))
+                cmd = TOOL(wpa_cli) + " -p /run/wpa_supplicant -i " + target + " roam " + request.data;
+            break;
+        case Protocol::DumpTrace:
+            complete(id, i, true, QString(), Protocol::TraceEvents, Trace::events());
+            continue;
+        case Protocol::Quit:
+            quitAfterwards = true;
+            complete(id, i, true, QString());
+            continue;
+        default:
+            break;
+        }
+        if (cmd.isNull())
+            complete(id, i, false, "ERROR: unsupported command / request:" + target);
+        else
+            run(cmd, id, QList<int>() << i);
+    }
+    if (!enableServices.isEmpty())
+        run(TOOL(systemctl) + " enable " + enableServices.join(" "), id, enableIndices);
+    if (!disableServices.isEmpty())
+        run(TOOL(systemctl) + " disable " + disableServices.join(" "), id, disableIndices);
+    myBatches[id].dispatching = false;
+    release(id);
+    if (quitAfterwards)
+        quit();
+}
+
+static void signalHandler(int signal)
+{
+    Log::crashDump(); // the flusher may never get to the last words
+    ::signal(signal, SIG_DFL);
+    raise(signal);
+}
+
 int main(int argc, char **argv)
 {
-    return QNetCtlTool(argc, argv).exec();
+    // runs as root, so the path is fixed: neither /tmp where anyone could plant a symlink
+    // (O_NOFOLLOW aside) nor anything the caller could pick from the environment
+    Log::open("/var/log/qnetctl_tool.log", Log::levelFromEnv("QNETCTL_LOG_LEVEL", Log::Info));
+    Log::captureQtMessages();
+    signal(SIGSEGV, signalHandler);
+    signal(SIGABRT, signalHandler);
+    const int ret = QNetCtlTool(argc, argv).exec();
+    Log::close();
+    return ret;
 }
\ No newline at end of file
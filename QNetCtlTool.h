@@ -2,9 +2,18 @@
 #define QNETCTLTOOL_H
 
 #include <QCoreApplication>
+#include <QMap>
+#include <QMultiMap>
+#include <QPair>
+#include <QProcess>
 #include <QStringList>
 
+#include "Protocol.h"
+
+class LinkMonitor;
 class QDBusInterface;
+class QTimer;
+class Nl80211;
 
 class QNetCtlTool : public QCoreApplication
 {
@@ -12,13 +21,65 @@ class QNetCtlTool : public QCoreApplication
 public:
     QNetCtlTool(int &argc, char **argv);
 private slots:
-    void chain();
-    void scanWifi(QString device = QString());
-    void reply();
-    void request(QString tag, QString information);
+    void addressAdded(QString device, QString address);
+    void batch(uint version, QByteArray requests);
+    void dumpScan();
+    void linkChanged(QString device, bool up, bool carrier);
+    void linkSetUpFailed(QString device, bool up, int error);
+    void linkTimeout();
+    void mlmeEvent(QString device, int event, QString bssid);
+    void processError(QProcess::ProcessError error);
+    void processFinished();
+    void processStarted();
+    void scanFailed(QString device);
+    void scanFinished(QString device);
 private:
+    // every result is replied as soon as it's there, only those ready at dispatch time share one reply
+    struct Batch {
+        Batch() : pending(0), dispatching(true) {}
+        Protocol::ResultList results;
+        QList<int> ready; // completed, not yet replied
+        int pending;      // not yet replied
+        bool dispatching;
+    };
+    // per device, so radios scan (and other requests run) concurrently w/o ever blocking
+    struct Scan {
+        enum State { Idle = 0, WaitingForUp, Scanning };
+        Scan() : state(Idle), broughtUp(false), timer(0), since(0) {}
+        State state;
+        bool broughtUp; // we set the link up and have to set it down again
+        QTimer *timer;  // gives up on WaitingForUp
+        qint64 since;   // Trace::now() when the state was entered
+        Protocol::ScanTarget target; // of the running scan
+    };
+    // a running "netctl switch-to", its phases are reported once each - unless they're undone
+    struct Attempt {
+        Attempt() : id(0), phases(0) {}
+        quint32 id;
+        int phases; // bits of the Protocol::Phase values reached
+    };
+    void complete(int batch, int index, bool ok, const QString &message,
+                  qint32 payloadType = Protocol::NoPayload, const QByteArray &payload = QByteArray());
+    void completeScan(const QString &device, bool ok, const QString &message,
+                      qint32 payloadType = Protocol::NoPayload, const QByteArray &payload = QByteArray());
+    void finishConnect(quint32 id, bool ok, const QString &message);
+    void finishScan(const QString &device, bool ok, const QString &message,
+                    qint32 payloadType = Protocol::NoPayload, const QByteArray &payload = QByteArray());
+    void progress(const QString &device, int phase, const QString &detail = QString());
+    void release(int batch);
+    void run(const QString &cmd, int batch, const QList<int> &indices);
+    void scanWifi(const QString &device, const Protocol::ScanTarget &target);
+    void startScan(const QString &device);
+    void watchConnect(quint32 id, const QString &profile);
     QDBusInterface *myClient;
-    QStringList myScanningDevices, myUplinkingDevices;
+    LinkMonitor *myLinkMonitor;
+    Nl80211 *myNl80211;
+    QMap<int, Batch> myBatches;
+    int myBatchId;
+    // every scan request for a device is answered by the one running scan
+    QMultiMap<QString, QPair<int, int> > myScanRequests;
+    QMap<QString, Scan> myScans;
+    QMap<QString, Attempt> myAttempts; // per device
 };
 
 #endif // QNETCTLTOOL_H
\ No newline at end of file
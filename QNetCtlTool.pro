@@ -1,6 +1,8 @@
 HEADERS     = QNetCtlTool.h
 SOURCES     = QNetCtlTool.cpp
 QT          += dbus
+LIBS        += -L$$OUT_PWD -lqnetctlcore
+PRE_TARGETDEPS += $$OUT_PWD/libqnetctlcore.a
 TARGET      = qnetctl_tool
 VERSION     = 0.1
 target.path += /usr/bin
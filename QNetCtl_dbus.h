@@ -32,14 +32,16 @@ private:
 
 public:
     QNetCtlAdaptor(QNetCtl *netCtl) : QDBusAbstractAdaptor(netCtl), myNetCtl(netCtl) {
-        connect(netCtl, SIGNAL(request(QString, QString)), SIGNAL(request(QString, QString)));
+        connect(netCtl, SIGNAL(batch(uint, QByteArray)), SIGNAL(batch(uint, QByteArray)));
     }
 
 public slots:
-    Q_NOREPLY void reply(QString tag, QString information) { myNetCtl->reply(tag, information); }
-//     Q_NOREPLY void triggerRequest(QString tag, QString information) { emit request(tag, information); }
+    Q_NOREPLY void batchReply(uint version, QByteArray results) { myNetCtl->batchReply(version, results); }
+    Q_NOREPLY void progress(uint version, QByteArray progress) { myNetCtl->progress(version, progress); }
+    // w/ reply, the helper quits if nobody answers
+    void helperReady(uint version) { myNetCtl->helperReady(version); }
 signals:
-    void request(QString info, QString tag);
+    void batch(uint version, QByteArray requests);
 };
 
 #endif // QNETCTL_ADAPTOR_H
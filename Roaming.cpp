@@ -0,0 +1,65 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Roaming.h"
+
+Roaming::Roaming()
+{
+    myClock.start();
+}
+
+double Roaming::score(const Connection &bss)
+{
+    double score = bss.signal ? bss.signal : -100.0;
+    if (bss.load > -1)
+        score -= 10.0 * bss.load / 255.0;
+    if (bss.frequency > 4900) // more channels, less interference - but it fades faster, so only a bit
+        score += 3.0;
+    return score;
+}
+
+bool Roaming::isBetter(const Connection &bss, const Connection &than)
+{
+    const double s1 = score(bss), s2 = score(than);
+    return s1 > s2 || (s1 == s2 && bss.associated && !than.associated);
+}
+
+QString Roaming::candidate(const QString &device, const QString &ssid, const QList<Connection> &bssList)
+{
+    const Connection *current = 0, *best = 0;
+    foreach (const Connection &bss, bssList) {
+        if (bss.SSID != ssid || bss.MAC.isEmpty())
+            continue;
+        if (bss.associated)
+            current = &bss;
+        else if (!best || isBetter(bss, *best))
+            best = &bss;
+    }
+    if (!(current && best) || current->signal > Threshold)
+        return QString(); // not associated (netctl is at it) or good enough
+    if (score(*best) - score(*current) < Hysteresis)
+        return QString();
+    const qint64 now = myClock.elapsed();
+    QHash<QString, qint64>::const_iterator last = myLastMove.constFind(device);
+    if (last != myLastMove.constEnd() && now - *last < HoldOff)
+        return QString();
+    myLastMove.insert(device, now); // also if the move fails, no retry storm
+    return best->MAC;
+}
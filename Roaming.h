@@ -0,0 +1,55 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_ROAMING_H
+#define QNETCTL_ROAMING_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "Connection.h"
+
+/**
+ * Picks the BSS a network should be used through and decides when to move there
+ * An SSID is often served by dozens of access points, netctl/wpa_supplicant stick to the one
+ * they associated with until it's lost entirely. Roaming asks for a move once the current BSS
+ * falls below Threshold and another one scores better by at least Hysteresis - and not more
+ * than once per HoldOff per interface, a move costs a few hundred ms of connectivity.
+ */
+class Roaming
+{
+public:
+    enum { Threshold = -70 /*dBm*/, Hysteresis = 8 /*dB*/, HoldOff = 60000 /*ms*/ };
+    Roaming();
+    /// dBm, the (smoothed) signal minus up to 10 dB for a busy channel plus 3 dB for 5 GHz
+    static double score(const Connection &bss);
+    /// the higher score, the associated BSS on a tie
+    static bool isBetter(const Connection &bss, const Connection &than);
+    /// the BSSID of the bss list the device should move to, null if it's fine where it is
+    QString candidate(const QString &device, const QString &ssid, const QList<Connection> &bssList);
+    void forget(const QString &device) { myLastMove.remove(device); }
+private:
+    QHash<QString, qint64> myLastMove; // per device
+    QElapsedTimer myClock;
+};
+
+#endif // QNETCTL_ROAMING_H
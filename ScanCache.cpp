@@ -0,0 +1,81 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "ScanCache.h"
+
+ScanCache::ScanCache() : myTTL(30000)
+{
+    myClock.start();
+}
+
+static inline bool differs(const Connection &c1, const Connection &c2)
+{
+    return c1.quality != c2.quality || c1.type != c2.type || c1.adHoc != c2.adHoc || c1.SSID != c2.SSID ||
+           c1.associated != c2.associated;
+}
+
+ScanCache::Delta ScanCache::update(const QList<Connection> &scan, const QSet<quint32> &coverage)
+{
+    Delta delta;
+    const qint64 now = myClock.elapsed();
+    foreach (const Connection &con, scan) {
+        if (con.MAC.isEmpty())
+            continue;
+        QHash<QString, Entry>::iterator it = myEntries.find(con.MAC);
+        if (it == myEntries.end()) {
+            Entry entry = { con, now, Inserted };
+            myEntries.insert(con.MAC, entry);
+            delta.inserted << con.MAC;
+            continue;
+        }
+        it->lastSeen = now;
+        if (differs(it->connection, con)) {
+            if (qAbs(it->connection.quality - con.quality) >= 10 || it->connection.type != con.type ||
+                it->connection.adHoc != con.adHoc || it->connection.SSID != con.SSID)
+                delta.significant = true;
+            it->change = Updated;
+            delta.updated << con.MAC;
+        } else {
+            it->change = Unchanged;
+        }
+        it->connection = con; // signal and load move w/o changing what the list shows
+    }
+    for (QHash<QString, Entry>::iterator it = myEntries.begin(); it != myEntries.end(); ) {
+        const quint32 frequency = it->connection.frequency;
+        if (now - it->lastSeen > myTTL && (coverage.isEmpty() || !frequency || coverage.contains(frequency))) {
+            delta.removed << it.key();
+            it = myEntries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    delta.significant = delta.significant || !(delta.inserted.isEmpty() && delta.removed.isEmpty());
+    return delta;
+}
+
+QList<Connection> ScanCache::connections() const
+{
+    QList<Connection> list;
+    list.reserve(myEntries.count());
+    for (QHash<QString, Entry>::const_iterator it = myEntries.constBegin(),
+                                              end = myEntries.constEnd(); it != end; ++it)
+        list << it->connection;
+    return list;
+}
@@ -0,0 +1,66 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_SCANCACHE_H
+#define QNETCTL_SCANCACHE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+#include "Connection.h"
+
+/**
+ * Persistent, BSSID keyed store of the scanned access points
+ * Scans are merged in rather than replacing the previous one, an AP that is missed by a
+ * single scan stays around until it has not been seen for ttl() milliseconds.
+ */
+class ScanCache
+{
+public:
+    enum Change { Unchanged = 0, Inserted, Updated };
+    struct Delta {
+        Delta() : significant(false) {}
+        QStringList inserted, updated, removed;
+        bool significant; // APs came or went, or changed by more than signal jitter
+        bool isEmpty() const { return inserted.isEmpty() && updated.isEmpty() && removed.isEmpty(); }
+    };
+    ScanCache();
+    int ttl() const { return myTTL; }
+    void setTTL(int ms) { myTTL = ms; }
+    /// merges the scan and returns which BSSIDs were inserted, updated or aged out
+    /// only entries on the covered frequencies (empty: all) can age out, a targeted scan isn't
+    /// evidence for the absence of APs on other channels
+    Delta update(const QList<Connection> &scan, const QSet<quint32> &coverage = QSet<quint32>());
+    QList<Connection> connections() const;
+    bool isEmpty() const { return myEntries.isEmpty(); }
+private:
+    struct Entry {
+        Connection connection;
+        qint64 lastSeen;
+        Change change;
+    };
+    QHash<QString, Entry> myEntries;
+    QElapsedTimer myClock;
+    int myTTL;
+};
+
+#endif // QNETCTL_SCANCACHE_H
@@ -0,0 +1,120 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "ScanScheduler.h"
+
+#include <QDBusConnection>
+#include <QTimer>
+#include <QtDebug>
+
+static const bool gs_debug = qgetenv("QNETCTL_DEBUG_SCAN").toInt();
+
+enum {  FastInterval = 2000,    // during a burst
+        BaseInterval = 8000,    // while things change
+        MaxInterval = 240000,   // stable for a long time
+        BurstLength = 3 };
+
+ScanScheduler::ScanScheduler(QObject *parent) : QObject(parent)
+, myInterval(BaseInterval)
+, myBurst(0)
+, iAmActive(true)
+, iSawChanges(false)
+{
+    myTimer = new QTimer(this);
+    myTimer->setSingleShot(true);
+    connect (myTimer, SIGNAL(timeout()), SLOT(fire()));
+    // a resumed machine is likely somewhere else
+    QDBusConnection::systemBus().connect("org.freedesktop.login1", "/org/freedesktop/login1",
+                                         "org.freedesktop.login1.Manager", "PrepareForSleep",
+                                         this, SLOT(prepareForSleep(bool)));
+}
+
+void ScanScheduler::arm(int ms, const QString &reason)
+{
+    if (gs_debug)
+        qDebug() << "scan scheduler:" << reason << "- next scan in" << ms/1000.0 << "s";
+    myTimer->start(ms);
+}
+
+void ScanScheduler::kick(const QString &reason)
+{
+    myBurst = BurstLength;
+    myInterval = BaseInterval;
+    iSawChanges = false;
+    if (iAmActive)
+        arm(FastInterval, reason);
+}
+
+void ScanScheduler::setActive(bool active)
+{
+    if (iAmActive == active)
+        return;
+    iAmActive = active;
+    if (active) {
+        kick("active");
+    } else {
+        myTimer->stop();
+        if (gs_debug)
+            qDebug() << "scan scheduler: inactive - no scans";
+    }
+}
+
+void ScanScheduler::prepareForSleep(bool sleep)
+{
+    if (sleep) {
+        myTimer->stop();
+        if (gs_debug)
+            qDebug() << "scan scheduler: suspending";
+    } else {
+        kick("resumed");
+    }
+}
+
+void ScanScheduler::observe(bool significant)
+{
+    if (!significant)
+        return;
+    iSawChanges = true;
+    if (myInterval <= BaseInterval)
+        return;
+    myInterval = BaseInterval;
+    if (iAmActive && myTimer->isActive() && myTimer->remainingTime() > BaseInterval)
+        arm(BaseInterval, "significant change");
+}
+
+void ScanScheduler::fire()
+{
+    emit scan();
+    if (myBurst > 0) {
+        --myBurst;
+        arm(myBurst ? FastInterval : myInterval, "burst");
+        return;
+    }
+    QString reason;
+    if (iSawChanges) {
+        myInterval = BaseInterval;
+        reason = "changing";
+    } else {
+        myInterval = qMin(2*myInterval, int(MaxInterval));
+        reason = "stable, backing off";
+    }
+    iSawChanges = false;
+    arm(myInterval, reason);
+}
@@ -0,0 +1,60 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_SCANSCHEDULER_H
+#define QNETCTL_SCANSCHEDULER_H
+
+#include <QObject>
+
+class QTimer;
+
+/**
+ * Decides when to scan next
+ * A kick (startup, resume, link loss, window shown) causes a short burst of fast scans, then the
+ * interval doubles with every round that brought no significant change until it reaches minutes.
+ * A significant change (APs appearing/vanishing, signal jumps) resets it to the base interval.
+ * While inactive (hidden window, suspend) there are no scans at all.
+ * export QNETCTL_DEBUG_SCAN=1 to have the decisions logged.
+ */
+class ScanScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    ScanScheduler(QObject *parent = 0);
+    /// the current interval in ms
+    int interval() const { return myInterval; }
+    /// feeds the outcome of a scan
+    void observe(bool significant);
+public slots:
+    void kick(const QString &reason);
+    void setActive(bool active);
+signals:
+    void scan();
+private slots:
+    void fire();
+    void prepareForSleep(bool sleep);
+private:
+    void arm(int ms, const QString &reason);
+    QTimer *myTimer;
+    int myInterval, myBurst;
+    bool iAmActive, iSawChanges;
+};
+
+#endif // QNETCTL_SCANSCHEDULER_H
@@ -0,0 +1,116 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "SignalHistory.h"
+#include "Connection.h"
+
+#include <math.h>
+
+SignalHistory::SignalHistory(int maxStations) : myMaxStations(qMax(1, maxStations))
+{
+    myStations.reserve(myMaxStations);
+    myClock.start();
+}
+
+void SignalHistory::add(const QString &bssid, int dBm, qint64 age)
+{
+    const qint64 taken = myClock.elapsed() - age;
+    QHash<QString, int>::const_iterator it = myIndex.constFind(bssid);
+    int i;
+    if (it != myIndex.constEnd()) {
+        i = *it;
+    } else if (myStations.count() < myMaxStations) {
+        i = myStations.count();
+        myStations.resize(i + 1);
+        myIndex.insert(bssid, i);
+    } else { // full, recycle the ring of the AP that is gone the longest
+        i = 0;
+        for (int j = 1; j < myStations.count(); ++j) {
+            if (myStations.at(j).lastSeen < myStations.at(i).lastSeen)
+                i = j;
+        }
+        myIndex.remove(myStations.at(i).bssid);
+        myIndex.insert(bssid, i);
+    }
+
+    Station &station = myStations[i];
+    if (station.bssid != bssid) {
+        station.bssid = bssid;
+        station.head = station.count = 0;
+        station.average = dBm;
+    } else if (taken - station.lastSeen < MinInterval) {
+        return;
+    } else {
+        // irregular intervals: the weight depends on the time since the last reading
+        const double alpha = 1.0 - exp(-double(taken - station.lastSeen) / TimeConstant);
+        station.average += alpha * (dBm - station.average);
+    }
+    station.lastSeen = taken;
+    Sample &sample = station.ring[station.head];
+    sample.time = taken;
+    sample.signal = dBm;
+    sample.smoothed = station.average;
+    station.head = (station.head + 1) % Depth;
+    station.count = qMin(station.count + 1, int(Depth));
+}
+
+double SignalHistory::smoothed(const QString &bssid) const
+{
+    const int i = myIndex.value(bssid, -1);
+    return i < 0 ? 0.0 : myStations.at(i).average;
+}
+
+int SignalHistory::quality(const QString &bssid, int fallback) const
+{
+    const int i = myIndex.value(bssid, -1);
+    return i < 0 ? fallback : Connection::qualityFromSignal(myStations.at(i).average);
+}
+
+double SignalHistory::trend(const QString &bssid) const
+{
+    const QVector<Sample> list = samples(bssid);
+    if (list.count() < 2)
+        return 0.0;
+    double st = 0.0, ss = 0.0, stt = 0.0, sts = 0.0;
+    const qint64 t0 = list.first().time;
+    foreach (const Sample &sample, list) {
+        const double t = (sample.time - t0) / 60000.0;
+        st += t;
+        ss += sample.signal;
+        stt += t*t;
+        sts += t*sample.signal;
+    }
+    const int n = list.count();
+    const double d = n*stt - st*st;
+    return d > 0.0 ? (n*sts - st*ss) / d : 0.0;
+}
+
+QVector<SignalHistory::Sample> SignalHistory::samples(const QString &bssid) const
+{
+    QVector<Sample> list;
+    const int i = myIndex.value(bssid, -1);
+    if (i < 0)
+        return list;
+    const Station &station = myStations.at(i);
+    list.reserve(station.count);
+    for (int j = station.count; j > 0; --j)
+        list << station.ring[(station.head - j + Depth) % Depth];
+    return list;
+}
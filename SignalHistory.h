@@ -0,0 +1,72 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_SIGNALHISTORY_H
+#define QNETCTL_SIGNALHISTORY_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * The last Depth signal readings of every access point, keyed by BSSID
+ * A single reading jitters by several dB between scans, the exponentially weighted moving
+ * average does not - it's what the list ranks and shows. The memory is bounded: there are
+ * at most maxStations() rings, the one that was not seen for the longest time is recycled.
+ */
+class SignalHistory
+{
+public:
+    enum { Depth = 32, MinInterval = 1000 /*ms*/, TimeConstant = 30000 /*ms*/ };
+    struct Sample {
+        qint64 time;      // ms, monotonic, when the reading was taken
+        float signal;     // dBm as scanned
+        float smoothed;   // dBm, the average after this sample
+    };
+    explicit SignalHistory(int maxStations = 256);
+    int maxStations() const { return myMaxStations; }
+    /// age: ms since the reading was taken - readings taken less than MinInterval after the
+    /// previous one are ignored, eg. the kernel cache still holding the frame of the last scan
+    void add(const QString &bssid, int dBm, qint64 age = 0);
+    bool contains(const QString &bssid) const { return myIndex.contains(bssid); }
+    /// the average in dBm, 0 if the BSSID is unknown
+    double smoothed(const QString &bssid) const;
+    /// Connection::qualityFromSignal(smoothed()), fallback if the BSSID is unknown
+    int quality(const QString &bssid, int fallback) const;
+    /// least squares slope of the readings in dB per minute, positive: getting better
+    double trend(const QString &bssid) const;
+    /// oldest first
+    QVector<Sample> samples(const QString &bssid) const;
+private:
+    struct Station {
+        QString bssid;
+        Sample ring[Depth];
+        int head, count; // next slot to write, valid samples
+        double average;
+        qint64 lastSeen;
+    };
+    QVector<Station> myStations;
+    QHash<QString, int> myIndex;
+    QElapsedTimer myClock;
+    int myMaxStations;
+};
+
+#endif // QNETCTL_SIGNALHISTORY_H
@@ -0,0 +1,70 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Snapshot.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtDebug>
+
+static const quint32 gs_magic = 0x514e4353; // "QNCS"
+static const quint16 gs_version = 3; // 2: Connection::signal, 3: ::load and ::associated
+
+static QString path()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/snapshot";
+}
+
+bool Snapshot::load()
+{
+    QFile file(path());
+    if (!file.open(QIODevice::ReadOnly))
+        return false; // first launch
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic;
+    quint16 version;
+    stream >> magic >> version;
+    if (magic != gs_magic || version != gs_version)
+        return false;
+    stream >> enabledProfiles >> activeProfiles >> scans >> knownFrequencies;
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "ignoring corrupt snapshot" << file.fileName();
+        *this = Snapshot();
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::save() const
+{
+    const QString fileName = path();
+    QDir().mkpath(fileName.section('/', 0, -2));
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << gs_magic << gs_version << enabledProfiles << activeProfiles << scans << knownFrequencies;
+    return file.commit();
+}
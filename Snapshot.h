@@ -0,0 +1,48 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_SNAPSHOT_H
+#define QNETCTL_SNAPSHOT_H
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QStringList>
+
+#include "Connection.h"
+
+/**
+ * What the last session knew, so the next one can show the list before netctl, systemd and
+ * the radios answered. The live data replaces it as it arrives.
+ * The profiles are not part of it, indexing them is a stat() per file and they hold the keys.
+ */
+class Snapshot
+{
+public:
+    QStringList enabledProfiles, activeProfiles;
+    QMap<QString, QList<Connection> > scans; // per radio
+    QHash<QString, QSet<quint32> > knownFrequencies; // per SSID of the saved networks
+    /// false if there's none or it was written by another version, the snapshot is empty then
+    bool load();
+    /// atomically replaces the previous snapshot
+    bool save() const;
+};
+
+#endif // QNETCTL_SNAPSHOT_H
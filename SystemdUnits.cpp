@@ -0,0 +1,135 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "SystemdUnits.h"
+
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QDBusPendingCallWatcher>
+#include <QRegExp>
+#include <QTimer>
+#include <QtDebug>
+
+static const char *gs_service = "org.freedesktop.systemd1";
+static const char *gs_path = "/org/freedesktop/systemd1";
+static const char *gs_manager = "org.freedesktop.systemd1.Manager";
+
+SystemdUnits::SystemdUnits(const QString &pattern, QObject *parent) : QObject(parent)
+, myPattern(pattern)
+, iHaveListByPatterns(true)
+{
+    myRefreshTimer = new QTimer(this);
+    myRefreshTimer->setSingleShot(true);
+    myRefreshTimer->setInterval(250); // "netctl enable" touches several units
+    connect (myRefreshTimer, SIGNAL(timeout()), SLOT(refresh()));
+
+    QDBusConnection bus = QDBusConnection::systemBus();
+    bus.connect(gs_service, gs_path, gs_manager, "UnitFilesChanged", myRefreshTimer, SLOT(start()));
+    bus.connect(gs_service, gs_path, gs_manager, "Reloading", this, SLOT(reloading(bool)));
+    // older systemd versions only signal to subscribed clients
+    bus.send(QDBusMessage::createMethodCall(gs_service, gs_path, gs_manager, "Subscribe"));
+}
+
+void SystemdUnits::refresh()
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(gs_service, gs_path, gs_manager,
+                                iHaveListByPatterns ? "ListUnitFilesByPatterns" : "ListUnitFiles");
+    if (iHaveListByPatterns)
+        msg << QStringList("enabled") << QStringList(myPattern);
+    QDBusPendingCallWatcher *call = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(msg), this);
+    connect (call, SIGNAL(finished(QDBusPendingCallWatcher*)), SLOT(readUnits(QDBusPendingCallWatcher*)));
+}
+
+QStringList SystemdUnits::activeUnits()
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(gs_service, gs_path, gs_manager,
+                                iHaveListByPatterns ? "ListUnitsByPatterns" : "ListUnits");
+    if (iHaveListByPatterns)
+        msg << QStringList("active") << QStringList(myPattern);
+    const QDBusMessage reply = QDBusConnection::systemBus().call(msg);
+    if (reply.type() == QDBusMessage::ErrorMessage) {
+        if (iHaveListByPatterns && reply.errorName() == "org.freedesktop.DBus.Error.UnknownMethod") {
+            iHaveListByPatterns = false;
+            return activeUnits();
+        }
+        qDebug() << "Failed to list systemd units" << reply.errorName() << reply.errorMessage();
+        return QStringList();
+    }
+
+    const QRegExp pattern(myPattern, Qt::CaseSensitive, QRegExp::Wildcard);
+    QStringList units;
+    // a(ssssssouso): name, description, load, active and sub state, followed unit, object path, job
+    const QDBusArgument list = reply.arguments().value(0).value<QDBusArgument>();
+    list.beginArray();
+    while (!list.atEnd()) {
+        QString name, description, load, active, sub, following, jobType;
+        QDBusObjectPath path, jobPath;
+        uint jobId;
+        list.beginStructure();
+        list >> name >> description >> load >> active >> sub >> following >> path >> jobId >> jobType >> jobPath;
+        list.endStructure();
+        if (active == "active" && (iHaveListByPatterns || pattern.exactMatch(name)))
+            units << name;
+    }
+    list.endArray();
+    return units;
+}
+
+void SystemdUnits::reloading(bool active)
+{
+    if (!active) // daemon-reload is done
+        myRefreshTimer->start();
+}
+
+void SystemdUnits::readUnits(QDBusPendingCallWatcher *call)
+{
+    call->deleteLater();
+    const QDBusMessage reply = call->reply();
+    if (reply.type() == QDBusMessage::ErrorMessage) {
+        if (iHaveListByPatterns && reply.errorName() == "org.freedesktop.DBus.Error.UnknownMethod") {
+            iHaveListByPatterns = false;
+            refresh();
+            return;
+        }
+        qDebug() << "Failed to list systemd units" << reply.errorName() << reply.errorMessage();
+        return;
+    }
+
+    const QRegExp pattern(myPattern, Qt::CaseSensitive, QRegExp::Wildcard);
+    QStringList units;
+    // a(ss): unit file path, state
+    const QDBusArgument list = reply.arguments().value(0).value<QDBusArgument>();
+    list.beginArray();
+    while (!list.atEnd()) {
+        QString path, state;
+        list.beginStructure();
+        list >> path >> state;
+        list.endStructure();
+        if (state != "enabled")
+            continue;
+        const QString unit = path.section('/', -1);
+        if (iHaveListByPatterns || pattern.exactMatch(unit))
+            units << unit;
+    }
+    list.endArray();
+    emit enabledUnits(units);
+}
@@ -0,0 +1,56 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_SYSTEMDUNITS_H
+#define QNETCTL_SYSTEMDUNITS_H
+
+#include <QObject>
+#include <QStringList>
+
+class QDBusPendingCallWatcher;
+class QTimer;
+
+/**
+ * Asks org.freedesktop.systemd1 on the system bus for the enabled unit files matching a
+ * pattern and follows UnitFilesChanged, so "netctl enable" from a shell shows up as well.
+ * Falls back to the complete ListUnitFiles for systemd < 230
+ */
+class SystemdUnits : public QObject
+{
+    Q_OBJECT
+public:
+    SystemdUnits(const QString &pattern, QObject *parent = 0);
+    /// names of the active units matching the pattern, blocks for one system bus round trip
+    QStringList activeUnits();
+public slots:
+    void refresh();
+signals:
+    /// names (w/o path) of the enabled units matching the pattern
+    void enabledUnits(QStringList units);
+private slots:
+    void readUnits(QDBusPendingCallWatcher *call);
+    void reloading(bool active);
+private:
+    QString myPattern;
+    QTimer *myRefreshTimer;
+    bool iHaveListByPatterns;
+};
+
+#endif // QNETCTL_SYSTEMDUNITS_H
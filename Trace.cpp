@@ -0,0 +1,114 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <time.h>
+
+struct Event
+{
+    const char *name;
+    QString detail;
+    qint64 start, duration;
+    quint32 id;
+    char phase;
+};
+
+static Event gs_events[Trace::Capacity];
+static quint64 gs_recorded = 0; // in total, the ring holds the last Capacity ones
+
+qint64 Trace::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void Trace::record(Phase phase, const char *name, quint32 id, const QString &detail, qint64 start, qint64 duration)
+{
+    Event &event = gs_events[gs_recorded++ % Capacity];
+    event.name = name;
+    event.detail = detail; // shared, no deep copy
+    event.start = start < 0 ? now() : start;
+    event.duration = duration;
+    event.id = id;
+    event.phase = phase;
+}
+
+QByteArray Trace::events()
+{
+    const int pid = QCoreApplication::applicationPid();
+    QJsonArray list;
+    QJsonObject process, processArgs;
+    processArgs.insert("name", QCoreApplication::applicationName());
+    process.insert("name", QLatin1String("process_name"));
+    process.insert("ph", QLatin1String("M"));
+    process.insert("pid", pid);
+    process.insert("args", processArgs);
+    list.append(process);
+
+    for (quint64 i = gs_recorded > Capacity ? gs_recorded - Capacity : 0; i < gs_recorded; ++i) {
+        const Event &event = gs_events[i % Capacity];
+        QJsonObject object, args;
+        object.insert("name", QLatin1String(event.name));
+        object.insert("cat", QLatin1String("qnetctl"));
+        object.insert("ph", QString(QLatin1Char(event.phase)));
+        object.insert("ts", event.start / 1000.0); // µs
+        object.insert("pid", pid);
+        object.insert("tid", pid);
+        if (event.phase == Complete)
+            object.insert("dur", event.duration / 1000.0);
+        else if (event.phase == Instant)
+            object.insert("s", QLatin1String("p"));
+        else // async events are matched by cat, name and id
+            object.insert("id", int(event.id));
+        if (event.id)
+            args.insert("request", int(event.id));
+        if (!event.detail.isEmpty())
+            args.insert("detail", event.detail);
+        if (!args.isEmpty())
+            object.insert("args", args);
+        list.append(object);
+    }
+    return QJsonDocument(list).toJson(QJsonDocument::Compact);
+}
+
+bool Trace::write(const QString &path, const QList<QByteArray> &events)
+{
+    QJsonArray all;
+    foreach (const QByteArray &list, events) {
+        foreach (const QJsonValue &event, QJsonDocument::fromJson(list).array())
+            all.append(event);
+    }
+    QJsonObject trace;
+    trace.insert("traceEvents", all);
+    trace.insert("displayTimeUnit", QLatin1String("ms"));
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
@@ -0,0 +1,66 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_TRACE_H
+#define QNETCTL_TRACE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+/**
+ * Always-on, in-memory event trace of the request path in the GUI and the helper
+ * Recording is a clock_gettime() and a store into a fixed ring (the last Capacity events,
+ * single threaded - both processes only record from their event loop). The events are only
+ * converted on demand, to chrome://tracing (Trace Event Format) JSON.
+ */
+namespace Trace
+{
+    enum { Capacity = 4096 };
+    enum Phase { Complete = 'X', Instant = 'i', AsyncBegin = 'b', AsyncEnd = 'e' };
+    /// CLOCK_MONOTONIC in ns - the same clock in the GUI and the helper, so their events line up
+    qint64 now();
+    /// name must outlive the buffer (literals, Protocol::name()), id is the request id (or 0),
+    /// start < 0 means now
+    void record(Phase phase, const char *name, quint32 id = 0, const QString &detail = QString(),
+                qint64 start = -1, qint64 duration = 0);
+    /// the buffered events of this process as a JSON array
+    QByteArray events();
+    /// merges the event arrays of several processes into one trace file
+    bool write(const QString &path, const QList<QByteArray> &events);
+
+    /// records a Complete event for its lifetime
+    class Span
+    {
+    public:
+        Span(const char *name, quint32 id = 0, const QString &detail = QString())
+            : myName(name), myDetail(detail), myId(id), myStart(now()) {}
+        ~Span() { record(Complete, myName, myId, myDetail, myStart, now() - myStart); }
+    private:
+        const char *myName;
+        QString myDetail;
+        quint32 myId;
+        qint64 myStart;
+    };
+}
+
+#define TRACE_SPAN(_N_) Trace::Span traceSpan(_N_)
+
+#endif // QNETCTL_TRACE_H
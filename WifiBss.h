@@ -0,0 +1,60 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef QNETCTL_WIFIBSS_H
+#define QNETCTL_WIFIBSS_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QList>
+
+/**
+ * One entry of the kernels BSS table as reported by nl80211
+ * This is what the tool sends to the GUI instead of the "iw scan" text dump
+ */
+struct WifiBss
+{
+    WifiBss() : signal(0), frequency(0), age(0), capability(0), load(-1), rsn(false), wpa(false), associated(false) {}
+    QByteArray bssid;   // 6 octets
+    QByteArray ssid;    // raw octets, not necessarily utf-8
+    qint32 signal;      // mBm, ie. dBm * 100
+    quint32 frequency;  // MHz
+    quint32 age;        // ms since a frame of the BSS was received, when the table was read
+    quint16 capability; // 802.11 capability field, 0x0002: IBSS, 0x0010: Privacy
+    qint16 load;        // channel utilization from the BSS Load element, 0..255 - -1: not advertised
+    bool rsn, wpa;      // RSN (WPA2) / vendor WPA information elements present
+    bool associated;    // the interface is associated with this BSS
+};
+
+typedef QList<WifiBss> WifiBssList;
+
+inline QDataStream &operator<<(QDataStream &s, const WifiBss &bss)
+{
+    return s << bss.bssid << bss.ssid << bss.signal << bss.frequency << bss.age << bss.capability << bss.load
+             << bss.rsn << bss.wpa << bss.associated;
+}
+
+inline QDataStream &operator>>(QDataStream &s, WifiBss &bss)
+{
+    return s >> bss.bssid >> bss.ssid >> bss.signal >> bss.frequency >> bss.age >> bss.capability >> bss.load
+             >> bss.rsn >> bss.wpa >> bss.associated;
+}
+
+#endif // QNETCTL_WIFIBSS_H
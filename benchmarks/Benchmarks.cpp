@@ -0,0 +1,248 @@
+/**************************************************************************
+*   Copyright (C) 2013 by Thomas Luebking                                 *
+*   thomas.luebking@gmail.com                                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+// qmake CONFIG+=benchmarks && make && ./benchmarks/benchmarks [-iterations 20 | -callgrind]
+// the fixtures are real "iw dev wlan0 scan", "ip link", "netctl list" and
+// "systemctl list-unit-files" outputs, the synthetic rows scale them up to what
+// a crowded place (5000 BSS, 2000 profiles) looks like
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtTest>
+
+#include "Connection.h"
+#include "Networks.h"
+
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void parseIwScan_data();
+    void parseIwScan();
+    void readProfiles_data();
+    void readProfiles();
+    void merge_data();
+    void merge();
+    void enabledProfiles_data();
+    void enabledProfiles();
+private:
+    QList<Connection> loadProfiles(int count) const;
+    QStringList unitFiles(int count) const;
+    QByteArray myIwScan, myIpLink, myNetctlList, myUnitFiles;
+    QTemporaryDir myProfileDir;
+};
+
+static QByteArray readFixture(const QString &name)
+{
+    QFile file(QString(FIXTURES) + "/" + name);
+    if (!file.open(QIODevice::ReadOnly))
+        qFatal("missing fixture %s", qPrintable(file.fileName()));
+    return file.readAll();
+}
+
+// n access points, three per SSID on alternating bands, every fourth one open
+static QByteArray synthesizeIwScan(int n)
+{
+    QByteArray scan;
+    char line[256];
+    for (int i = 0; i < n; ++i) {
+        const bool is5GHz = i % 3 == 1;
+        snprintf(line, sizeof(line), "BSS 02:00:%02x:%02x:%02x:%02x(on wlan0)%s\n"
+                                     "\tTSF: %d usec (0d, 00:00:01)\n"
+                                     "\tfreq: %d\n"
+                                     "\tbeacon interval: 100 TUs\n"
+                                     "\tcapability: ESS%s ShortSlotTime (0x0411)\n"
+                                     "\tsignal: -%d.00 dBm\n"
+                                     "\tlast seen: %d ms ago\n"
+                                     "\tSSID: net%d\n"
+                                     "\tSupported rates: 1.0* 2.0* 5.5* 11.0* 18.0 24.0 36.0 54.0 \n",
+                 (i >> 24) & 0xff, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, i ? "" : " -- associated",
+                 1000*i, is5GHz ? 5180 + 20*(i % 8) : 2412 + 5*(i % 13), i % 4 ? " Privacy" : "",
+                 40 + i % 50, i % 3000, i / 3);
+        scan += line;
+        if (i % 4)
+            scan += "\tRSN:\t * Version: 1\n"
+                    "\t\t * Group cipher: CCMP\n"
+                    "\t\t * Pairwise ciphers: CCMP\n"
+                    "\t\t * Authentication suites: PSK\n";
+    }
+    return scan;
+}
+
+void Benchmarks::initTestCase()
+{
+    myIwScan = readFixture("iw_scan.txt");
+    myIpLink = readFixture("ip_link.txt");
+    myNetctlList = readFixture("netctl_list.txt");
+    myUnitFiles = readFixture("systemctl_list_unit_files.txt");
+    QVERIFY(myProfileDir.isValid());
+    // profile i is for the access points of net<i>, so every synthetic SSID has one
+    for (int i = 0; i < 2000; ++i) {
+        QFile file(myProfileDir.path() + "/profile" + QString::number(i));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QTextStream ts(&file);
+        ts << "Description='synthetic profile " << i << "'\n"
+           << "Interface=wlan0\n"
+           << "Connection=wireless\n"
+           << (i % 4 ? "Security=wpa\n" : "Security=none\n")
+           << "ESSID=net" << i << "\n"
+           << "IP=dhcp\n";
+        if (i % 4)
+            ts << "Key='secret" << i << "'\n";
+        if (i % 10 == 0)
+            ts << "ExcludeAuto=yes\n";
+    }
+}
+
+// the fixture and two synthetic sizes, the column is the number of BSS or profiles (0: fixture)
+static void addRows(const char *column, int medium, int large)
+{
+    QTest::addColumn<int>(column);
+    QTest::newRow("fixture") << 0;
+    QTest::newRow("medium") << medium;
+    QTest::newRow("large") << large;
+}
+
+// profiles as the GUI reads them, the active one taken from "netctl list"
+QList<Connection> Benchmarks::loadProfiles(int count) const
+{
+    QList<Connection> list;
+    if (!count) {
+        const QString directory = QString(FIXTURES) + "/profiles/";
+        foreach (const QByteArray &line, myNetctlList.split('\n')) {
+            if (line.size() < 3)
+                continue;
+            Connection con(QString::fromUtf8(line.mid(2)), directory);
+            con.active = line.at(0) == '*';
+            list << con;
+        }
+        return list;
+    }
+    const QString directory = myProfileDir.path() + "/";
+    for (int i = 0; i < count; ++i)
+        list << Connection("profile" + QString::number(i), directory);
+    list[0].active = true;
+    return list;
+}
+
+// the first column of "systemctl list-unit-files", every fourth synthetic profile enabled
+QStringList Benchmarks::unitFiles(int count) const
+{
+    QStringList list;
+    if (!count) {
+        foreach (const QByteArray &line, myUnitFiles.split('\n')) {
+            const int end = line.indexOf(' ');
+            if (end > 0)
+                list << QString::fromUtf8(line.left(end));
+        }
+        return list;
+    }
+    list << "netctl-auto@wlan0.service" << "system-netctl.slice";
+    for (int i = 0; i < count; i += 4)
+        list << "netctl@profile" + QString::number(i) + ".service";
+    return list;
+}
+
+void Benchmarks::parseIwScan_data()
+{
+    addRows("bss", 500, 5000);
+}
+
+void Benchmarks::parseIwScan()
+{
+    QFETCH(int, bss);
+    const QByteArray scan = bss ? synthesizeIwScan(bss) : myIwScan;
+    QList<Connection> parsed;
+    QBENCHMARK {
+        parsed = Connection::parseIwScan(scan);
+    }
+    QCOMPARE(parsed.count(), bss ? bss : 5);
+}
+
+void Benchmarks::readProfiles_data()
+{
+    addRows("profiles", 200, 2000);
+}
+
+void Benchmarks::readProfiles()
+{
+    QFETCH(int, profiles);
+    QList<Connection> read;
+    QBENCHMARK {
+        read = loadProfiles(profiles);
+    }
+    QCOMPARE(read.count(), profiles ? profiles : 4);
+    QVERIFY(!read.at(0).SSID.isEmpty());
+}
+
+void Benchmarks::merge_data()
+{
+    QTest::addColumn<int>("bss");
+    QTest::addColumn<int>("profiles");
+    QTest::newRow("fixture") << 0 << 0;
+    QTest::newRow("medium") << 500 << 200;
+    QTest::newRow("large") << 5000 << 2000;
+}
+
+void Benchmarks::merge()
+{
+    QFETCH(int, bss);
+    QFETCH(int, profiles);
+    const QList<Connection> scanned = Networks::strongest(Connection::parseIwScan(bss ? synthesizeIwScan(bss) : myIwScan));
+    const QList<Connection> known = loadProfiles(profiles);
+    const QStringList enabled = Networks::enabledProfiles(unitFiles(profiles));
+    // "3: wlan0: <BROADCAST,MULTICAST,UP,LOWER_UP> ...", no loopback
+    QMap<QString, bool> devices;
+    foreach (const QByteArray &line, myIpLink.split('\n')) {
+        const int b = line.indexOf(": "), e = line.indexOf(": <");
+        if (b < 0 || e <= b || !line.mid(e).contains("BROADCAST"))
+            continue;
+        const QString device = QString::fromUtf8(line.mid(b + 2, e - b - 2));
+        devices.insert(device, device.startsWith("wl"));
+    }
+    QCOMPARE(devices.count(), 3);
+    QList<Connection> merged;
+    QBENCHMARK {
+        merged = Networks::merge(known, scanned, devices, enabled);
+    }
+    // one row per profile or SSID, plus enp3s0 and wlp0s20u2 that no synthetic profile uses
+    QCOMPARE(merged.count(), bss ? qMax(profiles, (bss + 2) / 3) + 2 : 6);
+}
+
+void Benchmarks::enabledProfiles_data()
+{
+    addRows("profiles", 200, 2000);
+}
+
+void Benchmarks::enabledProfiles()
+{
+    QFETCH(int, profiles);
+    const QStringList list = unitFiles(profiles);
+    QStringList enabled;
+    QBENCHMARK {
+        enabled = Networks::enabledProfiles(list);
+    }
+    QVERIFY(enabled.contains(profiles ? "profile0" : "office-ethernet"));
+}
+
+QTEST_GUILESS_MAIN(Benchmarks)
+#include "Benchmarks.moc"
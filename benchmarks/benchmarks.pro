@@ -0,0 +1,10 @@
+TEMPLATE    = app
+TARGET      = benchmarks
+CONFIG      += testcase
+CONFIG      -= app_bundle
+QT          = core dbus testlib
+INCLUDEPATH += ..
+SOURCES     = Benchmarks.cpp
+DEFINES     += FIXTURES=\\\"$$PWD/fixtures\\\"
+LIBS        += -L$$OUT_PWD/.. -lqnetctlcore
+PRE_TARGETDEPS += $$OUT_PWD/../libqnetctlcore.a
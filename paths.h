@@ -5,8 +5,9 @@
 
 static QString gs_profilePath("/etc/netctl/");
 static const struct {
-    QString ip, iw, netctl, qnetctl, rfkill, systemctl;
-} tools = { "/usr/bin/ip", "/usr/bin/iw", "/usr/bin/netctl", "/usr/bin/qnetctl_tool", "/usr/bin/rfkill", "/usr/bin/systemctl" };
+    QString ip, iw, netctl, qnetctl, rfkill, systemctl, wpa_cli;
+} tools = { "/usr/bin/ip", "/usr/bin/iw", "/usr/bin/netctl", "/usr/bin/qnetctl_tool", "/usr/bin/rfkill", "/usr/bin/systemctl",
+            "/usr/bin/wpa_cli" };
 
 #define TOOL(_T_) tools._T_
 
@@ -1,2 +1,5 @@
 TEMPLATE    = subdirs
-SUBDIRS     = QNetCtl.pro QNetCtlTool.pro
\ No newline at end of file
+CONFIG      += ordered
+SUBDIRS     = QNetCtlCore.pro QNetCtl.pro QNetCtlTool.pro
+# qmake CONFIG+=benchmarks, needs QtTest
+benchmarks: SUBDIRS += benchmarks